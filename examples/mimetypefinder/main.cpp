@@ -1,8 +1,60 @@
 #include "qmimedatabase.h"
+#include "qmimedirectoryscanner.h"
+#include "qmimefileindex.h"
 
+#include <QtCore/QAtomicInt>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QFile>
 
+// Counts the files classified while building or updating an index
+class CountingScanner : public QMimeDirectoryScanner
+{
+public:
+    int count() { return m_count.fetchAndAddRelaxed(0); }
+
+protected:
+    void classified(const QString &, const QMimeType &) { m_count.ref(); }
+
+private:
+    QAtomicInt m_count;
+};
+
+// -index-build, -index-update and -index-query <index> <path>
+static int runIndexCommand(const QString &option, const QString &indexPath, const QString &path)
+{
+    QMimeFileIndex index;
+    if (option == QLatin1String("-index-query")) {
+        if (!index.load(indexPath)) {
+            printf("Cannot load the index %s\n", qPrintable(indexPath));
+            return 1;
+        }
+        const QString name = index.recordedMimeTypeName(path);
+        if (name.isEmpty()) {
+            printf("Not indexed, or changed since\n");
+            return 1;
+        }
+        printf("%s\n", name.toLatin1().constData());
+        return 0;
+    }
+
+    if (option != QLatin1String("-index-build") && option != QLatin1String("-index-update")) {
+        printf("Unknown option %s\n", qPrintable(option));
+        return 1;
+    }
+    if (option == QLatin1String("-index-update") && !index.load(indexPath))
+        printf("Cannot load the index %s, building it\n", qPrintable(indexPath));
+    CountingScanner scanner;
+    scanner.setIndex(&index);
+    scanner.scan(path);
+    if (!index.save(indexPath)) {
+        printf("Cannot save the index %s\n", qPrintable(indexPath));
+        return 1;
+    }
+    printf("%d files, %d indexed, %d unchanged since the last scan\n",
+           scanner.count(), index.count(), index.reusedCount());
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     QCoreApplication a(argc, argv);
@@ -12,6 +64,10 @@ int main(int argc, char *argv[])
         return 1;
     }
     QString option;
+    if (argc == 4) {
+        option = QString::fromLatin1(argv[1]);
+        return runIndexCommand(option, QFile::decodeName(argv[2]), QFile::decodeName(argv[3]));
+    }
     int fnPos = 1;
     if (argc > 2) {
         option = QString::fromLatin1(argv[1]);
@@ -34,6 +90,10 @@ int main(int argc, char *argv[])
         }
     } else if (option == QLatin1String("-f")) {
         mime = db.findByName(fileName);
+    } else if (option == QLatin1String("-x")) {
+        const QMimeLookupTrace trace = db.traceFindByFile(fileName);
+        printf("%s", trace.toString().toLocal8Bit().constData());
+        mime = trace.result;
     } else {
         mime = db.findByFile(fileName);
     }
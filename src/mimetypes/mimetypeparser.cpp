@@ -30,6 +30,9 @@
 #include <QtCore/QXmlStreamReader>
 #include <QtCore/QXmlStreamWriter>
 #include <QtCore/QStack>
+#include <QtCore/QVarLengthArray>
+
+#include <string.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -84,17 +87,83 @@ const char *const matchMaskAttributeC = "mask";
     \brief Overwrite to process the sequence of parsed data
 */
 
-BaseMimeTypeParser::ParseState BaseMimeTypeParser::nextState(ParseState currentState, const QStringRef &startElement)
+BaseMimeTypeParser::TagName BaseMimeTypeParser::tagName(const QStringRef &name)
+{
+    if (name == QLatin1String(mimeTypeTagC))
+        return MimeTypeTag;
+    if (name == QLatin1String(commentTagC))
+        return CommentTag;
+    if (name == QLatin1String(globTagC))
+        return GlobTag;
+    if (name == QLatin1String(matchTagC))
+        return MatchTag;
+    if (name == QLatin1String(magicTagC))
+        return MagicTag;
+    if (name == QLatin1String(subClassTagC))
+        return SubClassTag;
+    if (name == QLatin1String(aliasTagC))
+        return AliasTag;
+    if (name == QLatin1String(genericIconTagC))
+        return GenericIconTag;
+    if (name == QLatin1String(iconTagC))
+        return IconTag;
+    if (name == QLatin1String(mimeInfoTagC))
+        return MimeInfoTag;
+    return OtherTag;
+}
+
+// Same as above, for the raw (UTF-8) bytes of a local name.
+// Comparing the length first rejects most candidates without looking at the characters.
+BaseMimeTypeParser::TagName BaseMimeTypeParser::tagName(const char *name, int length)
+{
+    switch (length) {
+    case 4:
+        if (memcmp(name, iconTagC, 4) == 0)
+            return IconTag;
+        if (memcmp(name, globTagC, 4) == 0)
+            return GlobTag;
+        break;
+    case 5:
+        if (memcmp(name, matchTagC, 5) == 0)
+            return MatchTag;
+        if (memcmp(name, magicTagC, 5) == 0)
+            return MagicTag;
+        if (memcmp(name, aliasTagC, 5) == 0)
+            return AliasTag;
+        break;
+    case 7:
+        if (memcmp(name, commentTagC, 7) == 0)
+            return CommentTag;
+        break;
+    case 9:
+        if (memcmp(name, mimeTypeTagC, 9) == 0)
+            return MimeTypeTag;
+        if (memcmp(name, mimeInfoTagC, 9) == 0)
+            return MimeInfoTag;
+        break;
+    case 12:
+        if (memcmp(name, subClassTagC, 12) == 0)
+            return SubClassTag;
+        if (memcmp(name, genericIconTagC, 12) == 0)
+            return GenericIconTag;
+        break;
+    default:
+        break;
+    }
+    return OtherTag;
+}
+
+BaseMimeTypeParser::ParseState BaseMimeTypeParser::nextState(ParseState currentState, TagName tag)
 {
     switch (currentState) {
     case ParseBeginning:
-        if (startElement == QLatin1String(mimeInfoTagC))
+        if (tag == MimeInfoTag)
             return ParseMimeInfo;
-        if (startElement == QLatin1String(mimeTypeTagC))
+        if (tag == MimeTypeTag)
             return ParseMimeType;
         return ParseError;
     case ParseMimeInfo:
-        return startElement == QLatin1String(mimeTypeTagC) ? ParseMimeType : ParseError;
+        return tag == MimeTypeTag ? ParseMimeType : ParseError;
     case ParseMimeType:
     case ParseComment:
     case ParseGenericIcon:
@@ -104,27 +173,30 @@ BaseMimeTypeParser::ParseState BaseMimeTypeParser::nextState(ParseState currentS
     case ParseAlias:
     case ParseOtherMimeTypeSubTag:
     case ParseMagicMatchRule:
-        if (startElement == QLatin1String(mimeTypeTagC)) // Sequence of <mime-type>
+        switch (tag) {
+        case MimeTypeTag: // Sequence of <mime-type>
             return ParseMimeType;
-        if (startElement == QLatin1String(commentTagC ))
+        case CommentTag:
             return ParseComment;
-        if (startElement == QLatin1String(genericIconTagC))
+        case GenericIconTag:
             return ParseGenericIcon;
-        if (startElement == QLatin1String(iconTagC))
+        case IconTag:
             return ParseIcon;
-        if (startElement == QLatin1String(globTagC))
+        case GlobTag:
             return ParseGlobPattern;
-        if (startElement == QLatin1String(subClassTagC))
+        case SubClassTag:
             return ParseSubClass;
-        if (startElement == QLatin1String(aliasTagC))
+        case AliasTag:
             return ParseAlias;
-        if (startElement == QLatin1String(magicTagC))
+        case MagicTag:
             return ParseMagic;
-        if (startElement == QLatin1String(matchTagC))
+        case MatchTag:
             return ParseMagicMatchRule;
-        return ParseOtherMimeTypeSubTag;
+        default:
+            return ParseOtherMimeTypeSubTag;
+        }
     case ParseMagic:
-        if (startElement == QLatin1String(matchTagC))
+        if (tag == MatchTag)
             return ParseMagicMatchRule;
         break;
     case ParseError:
@@ -148,170 +220,829 @@ static bool parseNumber(const QString &n, int *target, QString *errorMessage)
 // Evaluate a magic match rule like
 //  <match value="must be converted with BinHex" type="string" offset="11"/>
 //  <match value="0x9501" type="big16" offset="0:64"/>
-static bool createMagicMatchRule(const QXmlStreamAttributes &atts,
+template <typename Attributes>
+static bool createMagicMatchRule(const Attributes &atts,
                                  QString *errorMessage, QMimeMagicRule *&rule)
 {
-    const QString type = atts.value(QLatin1String(matchTypeAttributeC)).toString();
+    const QString type = atts.value(matchTypeAttributeC);
     QMimeMagicRule::Type magicType = QMimeMagicRule::type(type.toLatin1());
     if (magicType == QMimeMagicRule::Invalid) {
         qWarning("%s: match type %s is not supported.", Q_FUNC_INFO, type.toUtf8().constData());
         return true;
     }
-    const QString value = atts.value(QLatin1String(matchValueAttributeC)).toString();
+    const QString value = atts.value(matchValueAttributeC);
     if (value.isEmpty()) {
         *errorMessage = QString::fromLatin1("Empty match value detected.");
         return false;
     }
     // Parse for offset as "1" or "1:10"
     int startPos, endPos;
-    const QString offsetS = atts.value(QLatin1String(matchOffsetAttributeC)).toString();
+    const QString offsetS = atts.value(matchOffsetAttributeC);
     const int colonIndex = offsetS.indexOf(QLatin1Char(':'));
     const QString startPosS = colonIndex == -1 ? offsetS : offsetS.mid(0, colonIndex);
     const QString endPosS   = colonIndex == -1 ? offsetS : offsetS.mid(colonIndex + 1);
     if (!parseNumber(startPosS, &startPos, errorMessage) || !parseNumber(endPosS, &endPos, errorMessage))
         return false;
-    const QString mask = atts.value(QLatin1String(matchMaskAttributeC)).toString();
+    const QString mask = atts.value(matchMaskAttributeC);
 
     rule = new QMimeMagicRule(magicType, value.toUtf8(), startPos, endPos, mask.toLatin1());
 
     return true;
 }
 
-bool BaseMimeTypeParser::parse(QIODevice *dev, const QString &fileName, QString *errorMessage)
+// State of the parsing of one document
+struct BaseMimeTypeParser::ParseData
 {
+    ParseData() : priority(50) {}
+
     QMimeTypePrivate data;
-    int priority = 50;
+    int priority;
     QStack<QMimeMagicRule *> currentRules; // stack for the nesting of rules
     QList<QMimeMagicRule> rules; // toplevel rules
+};
+
+template <typename Attributes>
+BaseMimeTypeParser::ElementResult BaseMimeTypeParser::startElement(ParseData &pd, ParseState ps, const Attributes &atts, const QString &text,
+                                                                   QString *errorMessage, QString *error)
+{
+    QMimeTypePrivate &data = pd.data;
+    if (!(m_contents & MimeTypeContent)) {
+        switch (ps) {
+        case ParseGenericIcon:
+        case ParseIcon:
+        case ParseGlobPattern:
+        case ParseSubClass:
+        case ParseAlias:
+            return ElementOk;
+        default:
+            break;
+        }
+    }
+    switch (ps) {
+    case ParseMimeType: { // start parsing a MIME type name
+        const QString name = atts.value(mimeTypeAttributeC);
+        if (name.isEmpty()) {
+            *error = QString::fromLatin1("Missing '%1'-attribute").arg(QString::fromLatin1(mimeTypeAttributeC));
+            return ElementInvalid;
+        }
+        data.name = name;
+    }
+        break;
+    case ParseGenericIcon:
+        data.genericIconName = atts.value(nameAttributeC);
+        break;
+    case ParseIcon:
+        data.iconName = atts.value(nameAttributeC);
+        break;
+    case ParseGlobPattern: {
+        const QString pattern = atts.value(patternAttributeC);
+        unsigned weight = atts.value(weightAttributeC).toInt();
+        const bool caseSensitive = atts.value(caseSensitiveAttributeC) == QLatin1String("true");
+
+        if (weight == 0)
+            weight = QMimeGlobPattern::DefaultWeight;
+
+        Q_ASSERT(!data.name.isEmpty());
+        const QMimeGlobPattern glob(pattern, data.name, weight, caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
+        if (!process(glob, errorMessage))   // for actual glob matching
+            return ElementFailed;
+        data.addGlobPattern(pattern); // just for QMimeType::globPatterns()
+    }
+        break;
+    case ParseSubClass: {
+        const QString inheritsFrom = atts.value(mimeTypeAttributeC);
+        if (!inheritsFrom.isEmpty())
+            processParent(data.name, inheritsFrom);
+    }
+        break;
+    case ParseComment: {
+        // comments have locale attributes. We want the default, English one
+        QString locale = atts.value(localeAttributeC);
+        if (locale.isEmpty())
+            locale = QString::fromLatin1("en_US");
+        if (m_commentLocales.isEmpty() || m_commentLocales.contains(locale))
+            data.localeComments.insert(locale, text);
+    }
+        break;
+    case ParseAlias: {
+        const QString alias = atts.value(mimeTypeAttributeC);
+        if (!alias.isEmpty())
+            processAlias(alias, data.name);
+    }
+        break;
+    case ParseMagic: {
+        pd.priority = 50;
+        const QString priorityS = atts.value(priorityAttributeC);
+        if (!priorityS.isEmpty()) {
+            if (!parseNumber(priorityS, &pd.priority, errorMessage))
+                return ElementFailed;
+
+        }
+        pd.currentRules.clear();
+        //qDebug() << "MAGIC start for mimetype" << data.name;
+    }
+        break;
+    case ParseMagicMatchRule: {
+        QMimeMagicRule *rule = 0;
+        if (!createMagicMatchRule(atts, errorMessage, rule))
+            return ElementFailed;
+        QList<QMimeMagicRule> *ruleList;
+        if (pd.currentRules.isEmpty())
+            ruleList = &pd.rules;
+        else // nest this rule into the proper parent
+            ruleList = &pd.currentRules.top()->m_subMatches;
+        ruleList->append(*rule);
+        //qDebug() << " MATCH added. Stack size was" << currentRules.size();
+        pd.currentRules.push(&ruleList->last());
+        delete rule;
+        break;
+    }
+    default:
+        break;
+    }
+    return ElementOk;
+}
+
+bool BaseMimeTypeParser::endElement(ParseData &pd, TagName tag, QString *errorMessage)
+{
+    if (tag == MimeTypeTag) {
+        if (m_contents & MimeTypeContent) {
+            if (!process(QMimeType(pd.data), errorMessage))
+                return false;
+        } else if (m_contents & CommentContent) {
+            processComments(pd.data.name, pd.data.localeComments);
+        }
+        pd.data.clear();
+    } else if (tag == MatchTag) {
+        // Closing a <match> tag, pop stack
+        pd.currentRules.pop();
+        //qDebug() << " MATCH closed. Stack size is now" << currentRules.size();
+    } else if (tag == MagicTag) {
+        //qDebug() << "MAGIC ended, we got" << rules.count() << "rules, with prio" << priority;
+        // Finished a <magic> sequence
+        QMimeMagicRuleMatcher ruleMatcher(pd.data.name, pd.priority);
+        ruleMatcher.addRules(pd.rules);
+        processMagicMatcher(ruleMatcher);
+        pd.rules.clear();
+    }
+    return true;
+}
+
+// Elements which are skipped with everything they contain, as their content isn't wanted
+bool BaseMimeTypeParser::skipsElement(ParseState ps) const
+{
+    if (ps == ParseComment)
+        return !(m_contents & CommentContent);
+    if (ps == ParseMagic)
+        return !(m_contents & MagicContent);
+    return false;
+}
+
+namespace {
+
+// Attribute access for startElement(), from QXmlStreamReader
+class StreamAttributes
+{
+public:
+    explicit StreamAttributes(const QXmlStreamAttributes &atts) : m_atts(atts) {}
+
+    QString value(const char *qualifiedName) const
+    { return m_atts.value(QLatin1String(qualifiedName)).toString(); }
+
+private:
+    const QXmlStreamAttributes &m_atts;
+};
+
+} // namespace
+
+bool BaseMimeTypeParser::parse(QIODevice *dev, const QString &fileName, QString *errorMessage)
+{
+    ParseData pd;
     QXmlStreamReader reader(dev);
     ParseState ps = ParseBeginning;
     QXmlStreamAttributes atts;
     while (!reader.atEnd()) {
         switch (reader.readNext()) {
-        case QXmlStreamReader::StartElement:
-            ps = nextState(ps, reader.name());
-            atts = reader.attributes();
-            switch (ps) {
-            case ParseMimeType: { // start parsing a MIME type name
-                const QString name = atts.value(QLatin1String(mimeTypeAttributeC)).toString();
-                if (name.isEmpty()) {
-                    reader.raiseError(QString::fromLatin1("Missing '%1'-attribute").arg(QString::fromLatin1(mimeTypeAttributeC)));
-                } else {
-                    data.name = name;
-                }
+        case QXmlStreamReader::StartElement: {
+            ps = nextState(ps, tagName(reader.name()));
+            if (ps == ParseError) {
+                reader.raiseError(QString::fromLatin1("Unexpected element <%1>").
+                                  arg(reader.name().toString()));
+                break;
             }
+            if (skipsElement(ps)) {
+                reader.skipCurrentElement();
+                ps = ParseMimeType;
                 break;
-            case ParseGenericIcon:
-                data.genericIconName = atts.value(QLatin1String(nameAttributeC)).toString();
+            }
+            atts = reader.attributes();
+            QString text;
+            if (ps == ParseComment)
+                text = reader.readElementText();
+            QString error;
+            switch (startElement(pd, ps, StreamAttributes(atts), text, errorMessage, &error)) {
+            case ElementOk:
                 break;
-            case ParseIcon:
-                data.iconName = atts.value(QLatin1String(nameAttributeC)).toString();
+            case ElementFailed:
+                return false;
+            case ElementInvalid:
+                reader.raiseError(error);
                 break;
-            case ParseGlobPattern: {
-                const QString pattern = atts.value(QLatin1String(patternAttributeC)).toString();
-                unsigned weight = atts.value(QLatin1String(weightAttributeC)).toString().toInt();
-                const bool caseSensitive = atts.value(QLatin1String(caseSensitiveAttributeC)).toString() == QLatin1String("true");
+            }
+        }
+            break;
+        // continue switch QXmlStreamReader::Token...
+        case QXmlStreamReader::EndElement: // Finished element
+            if (!endElement(pd, tagName(reader.name()), errorMessage))
+                return false;
+            break;
+        default:
+            break;
+        }
+    }
 
-                if (weight == 0)
-                    weight = QMimeGlobPattern::DefaultWeight;
+    if (reader.hasError()) {
+        if (errorMessage)
+            *errorMessage = QString::fromLatin1("An error has been encountered at line %1 of %2: %3:").arg(reader.lineNumber()).arg(fileName, reader.errorString());
+        return false;
+    }
+
+    return true;
+}
+
+/*
+   A parser for the subset of XML used by shared-mime-info files, working directly on
+   the (usually memory-mapped) bytes of the file. Tag names are recognized by length and
+   memcmp, attributes are only decoded into a QString when they are asked for, and
+   no intermediate tokens are built.
+
+   Anything it cannot handle in exactly the same way as QXmlStreamReader (other encodings
+   than UTF-8, entity declarations in the DTD) is detected before anything is processed,
+   so that the caller can fall back to parse().
+ */
+
+namespace {
+
+struct FastAttribute
+{
+    const char *name;
+    int nameLength;
+    const char *value;
+    int valueLength;
+};
+
+struct FastTag
+{
+    const char *name;
+    int length;
+};
+
+static inline bool isXmlSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+static void appendUtf8(QByteArray &out, uint c)
+{
+    if (c < 0x80) {
+        out += char(c);
+    } else if (c < 0x800) {
+        out += char(0xc0 | (c >> 6));
+        out += char(0x80 | (c & 0x3f));
+    } else if (c < 0x10000) {
+        out += char(0xe0 | (c >> 12));
+        out += char(0x80 | ((c >> 6) & 0x3f));
+        out += char(0x80 | (c & 0x3f));
+    } else {
+        out += char(0xf0 | (c >> 18));
+        out += char(0x80 | ((c >> 12) & 0x3f));
+        out += char(0x80 | ((c >> 6) & 0x3f));
+        out += char(0x80 | (c & 0x3f));
+    }
+}
+
+// Decodes character data or an attribute value: predefined and numeric entities,
+// line ending normalization, and whitespace normalization for attributes.
+static bool decodeXml(const char *p, const char *e, bool isAttribute, QString *result)
+{
+    const char *it = p;
+    for ( ; it != e; ++it) {
+        if (*it == '&' || *it == '\r' || (isAttribute && (*it == '\n' || *it == '\t')))
+            break;
+    }
+    if (it == e) { // the common case
+        *result = QString::fromUtf8(p, e - p);
+        return true;
+    }
 
-                Q_ASSERT(!data.name.isEmpty());
-                const QMimeGlobPattern glob(pattern, data.name, weight, caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
-                if (!process(glob, errorMessage))   // for actual glob matching
+    QByteArray decoded(p, it - p);
+    decoded.reserve(e - p);
+    for ( ; it != e; ++it) {
+        const char c = *it;
+        if (c == '&') {
+            const char *semicolon = static_cast<const char *>(memchr(it, ';', qMin<qptrdiff>(e - it, 12)));
+            if (!semicolon)
+                return false;
+            const char *name = it + 1;
+            const int nameLength = semicolon - name;
+            if (nameLength == 2 && memcmp(name, "lt", 2) == 0) {
+                decoded += '<';
+            } else if (nameLength == 2 && memcmp(name, "gt", 2) == 0) {
+                decoded += '>';
+            } else if (nameLength == 3 && memcmp(name, "amp", 3) == 0) {
+                decoded += '&';
+            } else if (nameLength == 4 && memcmp(name, "quot", 4) == 0) {
+                decoded += '"';
+            } else if (nameLength == 4 && memcmp(name, "apos", 4) == 0) {
+                decoded += '\'';
+            } else if (nameLength >= 2 && name[0] == '#') {
+                bool ok;
+                const QByteArray number = name[1] == 'x'
+                        ? QByteArray(name + 2, nameLength - 2)
+                        : QByteArray(name + 1, nameLength - 1);
+                const uint codePoint = number.toUInt(&ok, name[1] == 'x' ? 16 : 10);
+                if (!ok || codePoint == 0 || codePoint > 0x10ffff)
                     return false;
-                data.addGlobPattern(pattern); // just for QMimeType::globPatterns()
+                appendUtf8(decoded, codePoint);
+            } else {
+                return false;
             }
-                break;
-            case ParseSubClass: {
-                const QString inheritsFrom = atts.value(QLatin1String(mimeTypeAttributeC)).toString();
-                if (!inheritsFrom.isEmpty())
-                    processParent(data.name, inheritsFrom);
+            it = semicolon;
+        } else if (c == '\r') {
+            // "\r\n" and "\r" both become "\n"
+            if (it + 1 != e && it[1] == '\n')
+                ++it;
+            decoded += isAttribute ? ' ' : '\n';
+        } else if (isAttribute && (c == '\n' || c == '\t')) {
+            decoded += ' ';
+        } else {
+            decoded += c;
+        }
+    }
+    *result = QString::fromUtf8(decoded.constData(), decoded.size());
+    return true;
+}
+
+class FastAttributes
+{
+public:
+    FastAttributes() : m_valid(true) {}
+
+    void clear() { m_attributes.clear(); }
+    void append(const FastAttribute &attribute) { m_attributes.append(attribute); }
+
+    QString value(const char *qualifiedName) const
+    {
+        const int length = int(qstrlen(qualifiedName));
+        for (int i = 0; i < m_attributes.size(); ++i) {
+            const FastAttribute &attribute = m_attributes.at(i);
+            if (attribute.nameLength == length && memcmp(attribute.name, qualifiedName, length) == 0) {
+                QString result;
+                if (!decodeXml(attribute.value, attribute.value + attribute.valueLength, true, &result))
+                    m_valid = false;
+                return result;
             }
-                break;
-            case ParseComment: {
-                // comments have locale attributes. We want the default, English one
-                QString locale = atts.value(QLatin1String(localeAttributeC)).toString();
-                const QString comment = reader.readElementText();
-                if (locale.isEmpty())
-                    locale = QString::fromLatin1("en_US");
-                data.localeComments.insert(locale, comment);
+        }
+        return QString();
+    }
+
+    // false if a value had an undefined entity reference
+    bool isValid() const { return m_valid; }
+
+private:
+    QVarLengthArray<FastAttribute, 8> m_attributes;
+    mutable bool m_valid;
+};
+
+class FastXmlScanner
+{
+public:
+    FastXmlScanner(const char *data, int size)
+        : m_begin(data), m_pos(data), m_end(data + size), m_errorPos(0), m_unsupported(false)
+    {}
+
+    bool atEnd() const { return m_pos >= m_end; }
+    const char *pos() const { return m_pos; }
+    void setPos(const char *p) { m_pos = p; }
+
+    bool lookingAt(const char *s, int length) const
+    { return m_end - m_pos >= length && memcmp(m_pos, s, length) == 0; }
+
+    void skipSpace()
+    {
+        while (m_pos < m_end && isXmlSpace(*m_pos))
+            ++m_pos;
+    }
+
+    const char *find(const char *s, int length, const char *from) const
+    {
+        const char *p = from;
+        while (m_end - p >= length) {
+            p = static_cast<const char *>(memchr(p, s[0], m_end - p));
+            if (!p || m_end - p < length)
+                return 0;
+            if (memcmp(p, s, length) == 0)
+                return p;
+            ++p;
+        }
+        return 0;
+    }
+
+    // Moves past the next occurrence of s
+    bool skipPast(const char *s, int length)
+    {
+        const char *p = find(s, length, m_pos);
+        if (!p)
+            return setError("Premature end of document.");
+        m_pos = p + length;
+        return true;
+    }
+
+    bool readName(FastTag *name)
+    {
+        const char *start = m_pos;
+        while (m_pos < m_end && !isXmlSpace(*m_pos) && *m_pos != '>' && *m_pos != '/' && *m_pos != '=')
+            ++m_pos;
+        name->name = start;
+        name->length = m_pos - start;
+        if (!name->length)
+            return setError("Invalid XML name.");
+        return true;
+    }
+
+    // Called after the element name, reads up to and including '>' or "/>".
+    bool readAttributes(FastAttributes *attributes, bool *selfClosing)
+    {
+        attributes->clear();
+        for (;;) {
+            skipSpace();
+            if (atEnd())
+                return setError("Premature end of document.");
+            if (*m_pos == '>') {
+                ++m_pos;
+                *selfClosing = false;
+                return true;
             }
-                break;
-            case ParseAlias: {
-                const QString alias = atts.value(QLatin1String(mimeTypeAttributeC)).toString();
-                if (!alias.isEmpty())
-                    processAlias(alias, data.name);
+            if (*m_pos == '/') {
+                if (!lookingAt("/>", 2))
+                    return setError("Expected '>'.");
+                m_pos += 2;
+                *selfClosing = true;
+                return true;
             }
-                break;
-            case ParseMagic: {
-                priority = 50;
-                const QString priorityS = atts.value(QLatin1String(priorityAttributeC)).toString();
-                if (!priorityS.isEmpty()) {
-                    if (!parseNumber(priorityS, &priority, errorMessage))
+            FastAttribute attribute;
+            FastTag name;
+            if (!readName(&name))
+                return false;
+            attribute.name = name.name;
+            attribute.nameLength = name.length;
+            skipSpace();
+            if (atEnd() || *m_pos != '=')
+                return setError("Expected '='.");
+            ++m_pos;
+            skipSpace();
+            if (atEnd() || (*m_pos != '"' && *m_pos != '\''))
+                return setError("Expected '\"' or '''.");
+            const char quote = *m_pos++;
+            const char *valueEnd = static_cast<const char *>(memchr(m_pos, quote, m_end - m_pos));
+            if (!valueEnd)
+                return setError("Premature end of document.");
+            if (memchr(m_pos, '<', valueEnd - m_pos))
+                return setError("Invalid character '<' in attribute value.");
+            attribute.value = m_pos;
+            attribute.valueLength = valueEnd - m_pos;
+            attributes->append(attribute);
+            m_pos = valueEnd + 1;
+        }
+    }
+
+    // Skips <!DOCTYPE ...>, including an internal subset.
+    // Entity declarations would change the meaning of the document: not supported.
+    bool skipDoctype()
+    {
+        m_pos += 9; // "<!DOCTYPE"
+        while (m_pos < m_end) {
+            const char c = *m_pos;
+            if (c == '"' || c == '\'') {
+                const char *closing = static_cast<const char *>(memchr(m_pos + 1, c, m_end - m_pos - 1));
+                if (!closing)
+                    break;
+                m_pos = closing + 1;
+            } else if (c == '[') {
+                // internal subset, up to the closing ']'
+                ++m_pos;
+                while (m_pos < m_end && *m_pos != ']') {
+                    if (lookingAt("<!--", 4)) {
+                        if (!skipPast("-->", 3))
+                            return false;
+                    } else if (lookingAt("<!ENTITY", 8)) {
+                        m_unsupported = true;
                         return false;
+                    } else if (*m_pos == '"' || *m_pos == '\'') {
+                        const char *closing = static_cast<const char *>(memchr(m_pos + 1, *m_pos, m_end - m_pos - 1));
+                        if (!closing)
+                            return setError("Premature end of document.");
+                        m_pos = closing + 1;
+                    } else {
+                        ++m_pos;
+                    }
+                }
+                if (m_pos < m_end)
+                    ++m_pos;
+            } else if (c == '>') {
+                ++m_pos;
+                return true;
+            } else {
+                ++m_pos;
+            }
+        }
+        return setError("Premature end of document.");
+    }
 
+    // Moves past the end tag of element, which must not contain an element of the same name.
+    // What is skipped isn't checked for well-formedness.
+    bool skipElement(const FastTag &element)
+    {
+        for (;;) {
+            const char *p = find("</", 2, m_pos);
+            if (!p)
+                return setError("Premature end of document.");
+            m_pos = p + 2;
+            if (m_end - m_pos >= element.length && memcmp(m_pos, element.name, element.length) == 0) {
+                const char *after = m_pos + element.length;
+                while (after < m_end && isXmlSpace(*after))
+                    ++after;
+                if (after < m_end && *after == '>') {
+                    m_pos = after + 1;
+                    return true;
                 }
-                currentRules.clear();
-                //qDebug() << "MAGIC start for mimetype" << data.name;
             }
-                break;
-            case ParseMagicMatchRule: {
-                QMimeMagicRule *rule = 0;
-                if (!createMagicMatchRule(atts, errorMessage, rule))
+        }
+    }
+
+    // <?xml ... encoding="..."?>: only UTF-8 (and its ASCII subset) is handled here.
+    bool readXmlDeclaration()
+    {
+        const char *end = find("?>", 2, m_pos);
+        if (!end)
+            return setError("Premature end of document.");
+        const char *encoding = find("encoding", 8, m_pos);
+        if (encoding && encoding < end) {
+            const char *p = encoding + 8;
+            while (p < end && (isXmlSpace(*p) || *p == '='))
+                ++p;
+            if (p < end && (*p == '"' || *p == '\'')) {
+                const char *closing = static_cast<const char *>(memchr(p + 1, *p, end - p - 1));
+                if (closing) {
+                    const QByteArray name = QByteArray(p + 1, closing - p - 1).toLower();
+                    if (name != "utf-8" && name != "utf8" && name != "us-ascii" && name != "ascii") {
+                        m_unsupported = true;
+                        return false;
+                    }
+                }
+            }
+        }
+        m_pos = end + 2;
+        return true;
+    }
+
+    // Reads the text content of an element up to and including its end tag,
+    // like QXmlStreamReader::readElementText()
+    bool readElementText(const FastTag &element, QString *text)
+    {
+        QString result;
+        for (;;) {
+            const char *lt = static_cast<const char *>(memchr(m_pos, '<', m_end - m_pos));
+            if (!lt)
+                return setError("Premature end of document.");
+            if (lt != m_pos) {
+                QString chunk;
+                if (!decodeXml(m_pos, lt, false, &chunk))
+                    return setError("Entity not declared.");
+                if (result.isEmpty())
+                    result = chunk;
+                else
+                    result += chunk;
+            }
+            m_pos = lt;
+            if (lookingAt("</", 2)) {
+                m_pos += 2;
+                FastTag name;
+                if (!readName(&name))
+                    return false;
+                if (name.length != element.length || memcmp(name.name, element.name, name.length) != 0)
+                    return setError("Opening and ending tag mismatch.");
+                skipSpace();
+                if (atEnd() || *m_pos != '>')
+                    return setError("Expected '>'.");
+                ++m_pos;
+                *text = result;
+                return true;
+            } else if (lookingAt("<!--", 4)) {
+                if (!skipPast("-->", 3))
+                    return false;
+            } else if (lookingAt("<![CDATA[", 9)) {
+                const char *cdata = m_pos + 9;
+                const char *cdataEnd = find("]]>", 3, cdata);
+                if (!cdataEnd)
+                    return setError("Premature end of document.");
+                result += QString::fromUtf8(cdata, cdataEnd - cdata);
+                m_pos = cdataEnd + 3;
+            } else if (lookingAt("<?", 2)) {
+                if (!skipPast("?>", 2))
                     return false;
-                QList<QMimeMagicRule> *ruleList;
-                if (currentRules.isEmpty())
-                    ruleList = &rules;
-                else // nest this rule into the proper parent
-                    ruleList = &currentRules.top()->m_subMatches;
-                ruleList->append(*rule);
-                //qDebug() << " MATCH added. Stack size was" << currentRules.size();
-                currentRules.push(&ruleList->last());
-                delete rule;
+            } else {
+                return setError("Expected character data.");
+            }
+        }
+    }
+
+    bool setError(const char *message)
+    {
+        if (!m_errorPos) {
+            m_errorPos = m_pos < m_end ? m_pos : m_end;
+            m_error = QString::fromLatin1(message);
+        }
+        return false;
+    }
+
+    bool setError(const QString &message)
+    {
+        if (!m_errorPos) {
+            m_errorPos = m_pos < m_end ? m_pos : m_end;
+            m_error = message;
+        }
+        return false;
+    }
+
+    bool isUnsupported() const { return m_unsupported; }
+    QString errorString() const { return m_error; }
+
+    int errorLineNumber() const
+    {
+        int line = 1;
+        for (const char *p = m_begin; p < m_errorPos; ++p) {
+            if (*p == '\n')
+                ++line;
+        }
+        return line;
+    }
+
+private:
+    const char *m_begin;
+    const char *m_pos;
+    const char *m_end;
+    const char *m_errorPos;
+    QString m_error;
+    bool m_unsupported;
+};
+
+// For tag names: the part after the namespace prefix, if any
+static inline FastTag localName(const FastTag &qualifiedName)
+{
+    const char *colon = static_cast<const char *>(memchr(qualifiedName.name, ':', qualifiedName.length));
+    if (!colon)
+        return qualifiedName;
+    FastTag result;
+    result.name = colon + 1;
+    result.length = qualifiedName.length - (colon + 1 - qualifiedName.name);
+    return result;
+}
+
+} // namespace
+
+BaseMimeTypeParser::FastParseResult BaseMimeTypeParser::parseFast(const char *data, int size, const QString &fileName, QString *errorMessage)
+{
+    // A UTF-16 byte order mark: let QXmlStreamReader do the decoding
+    if (size >= 2 && ((uchar(data[0]) == 0xfe && uchar(data[1]) == 0xff) || (uchar(data[0]) == 0xff && uchar(data[1]) == 0xfe)))
+        return FastParseUnsupported;
+
+    FastXmlScanner scanner(data, size);
+    if (scanner.lookingAt("\xef\xbb\xbf", 3)) // UTF-8 byte order mark
+        scanner.setPos(data + 3);
+
+    ParseData pd;
+    ParseState ps = ParseBeginning;
+    bool seenRootElement = false;
+    bool ok = true;
+    QVarLengthArray<FastTag, 16> openElements;
+    FastAttributes attributes;
+
+    while (ok && !scanner.atEnd()) {
+        const char *lt = static_cast<const char *>(memchr(scanner.pos(), '<', data + size - scanner.pos()));
+        if (!lt) // trailing whitespace
+            break;
+        scanner.setPos(lt);
+
+        if (scanner.lookingAt("<?", 2)) {
+            if (!seenRootElement && scanner.lookingAt("<?xml", 5) && lt + 5 < data + size && isXmlSpace(lt[5]))
+                ok = scanner.readXmlDeclaration();
+            else
+                ok = scanner.skipPast("?>", 2);
+        } else if (scanner.lookingAt("<!--", 4)) {
+            ok = scanner.skipPast("-->", 3);
+        } else if (scanner.lookingAt("<![CDATA[", 9)) {
+            ok = scanner.skipPast("]]>", 3);
+        } else if (scanner.lookingAt("<!DOCTYPE", 9)) {
+            if (seenRootElement)
+                ok = scanner.setError("Unexpected DOCTYPE declaration.");
+            else
+                ok = scanner.skipDoctype();
+        } else if (scanner.lookingAt("</", 2)) {
+            scanner.setPos(lt + 2);
+            FastTag name;
+            if (!scanner.readName(&name)) {
+                ok = false;
                 break;
             }
-            case ParseError:
-                reader.raiseError(QString::fromLatin1("Unexpected element <%1>").
-                                  arg(reader.name().toString()));
+            scanner.skipSpace();
+            if (scanner.atEnd() || *scanner.pos() != '>') {
+                ok = scanner.setError("Expected '>'.");
+                break;
+            }
+            scanner.setPos(scanner.pos() + 1);
+            if (openElements.isEmpty()
+                || openElements.last().length != name.length
+                || memcmp(openElements.last().name, name.name, name.length) != 0) {
+                ok = scanner.setError("Opening and ending tag mismatch.");
                 break;
-            default:
+            }
+            openElements.removeLast();
+            const FastTag local = localName(name);
+            if (!endElement(pd, tagName(local.name, local.length), errorMessage))
+                return FastParseFailed;
+        } else {
+            scanner.setPos(lt + 1);
+            if (openElements.isEmpty() && seenRootElement) {
+                ok = scanner.setError("Extra content at end of document.");
                 break;
             }
-            break;
-        // continue switch QXmlStreamReader::Token...
-        case QXmlStreamReader::EndElement: // Finished element
-        {
-            const QStringRef elementName = reader.name();
-            if (elementName == QLatin1String(mimeTypeTagC)) {
-                if (!process(QMimeType(data), errorMessage))
-                    return false;
-                data.clear();
-            } else if (elementName == QLatin1String(matchTagC)) {
-                // Closing a <match> tag, pop stack
-                currentRules.pop();
-                //qDebug() << " MATCH closed. Stack size is now" << currentRules.size();
-            } else if (elementName == QLatin1String(magicTagC)) {
-                //qDebug() << "MAGIC ended, we got" << rules.count() << "rules, with prio" << priority;
-                // Finished a <magic> sequence
-                QMimeMagicRuleMatcher ruleMatcher(data.name, priority);
-                ruleMatcher.addRules(rules);
-                processMagicMatcher(ruleMatcher);
-                rules.clear();
+            FastTag name;
+            bool selfClosing = false;
+            if (!scanner.readName(&name) || !scanner.readAttributes(&attributes, &selfClosing)) {
+                ok = false;
+                break;
             }
-            break;
-        }
-        default:
-            break;
+            seenRootElement = true;
+            const FastTag local = localName(name);
+            const TagName tag = tagName(local.name, local.length);
+            ps = nextState(ps, tag);
+            if (ps == ParseError) {
+                ok = scanner.setError(QString::fromLatin1("Unexpected element <%1>").
+                                      arg(QString::fromUtf8(local.name, local.length)));
+                break;
+            }
+            if (skipsElement(ps)) {
+                if (!selfClosing && !scanner.skipElement(name)) {
+                    ok = false;
+                    break;
+                }
+                ps = ParseMimeType;
+                continue;
+            }
+            QString text;
+            if (ps == ParseComment && !selfClosing) {
+                // Consumes the end tag too, like QXmlStreamReader::readElementText()
+                if (!scanner.readElementText(name, &text)) {
+                    ok = false;
+                    break;
+                }
+                selfClosing = true;
+            }
+            QString error;
+            switch (startElement(pd, ps, attributes, text, errorMessage, &error)) {
+            case ElementOk:
+                break;
+            case ElementFailed:
+                return FastParseFailed;
+            case ElementInvalid:
+                ok = scanner.setError(error);
+                break;
+            }
+            if (ok && !attributes.isValid())
+                ok = scanner.setError("Entity not declared.");
+            if (!ok)
+                break;
+            if (!selfClosing)
+                openElements.append(name);
+            else if (ps != ParseComment && !endElement(pd, tag, errorMessage))
+                return FastParseFailed;
         }
     }
 
-    if (reader.hasError()) {
+    if (scanner.isUnsupported())
+        return FastParseUnsupported;
+
+    if (ok && (!openElements.isEmpty() || !seenRootElement))
+        ok = scanner.setError("Premature end of document.");
+
+    if (!ok) {
         if (errorMessage)
-            *errorMessage = QString::fromLatin1("An error has been encountered at line %1 of %2: %3:").arg(reader.lineNumber()).arg(fileName, reader.errorString());
-        return false;
+            *errorMessage = QString::fromLatin1("An error has been encountered at line %1 of %2: %3:").arg(scanner.errorLineNumber()).arg(fileName, scanner.errorString());
+        return FastParseFailed;
     }
 
-    return true;
+    return FastParseSucceeded;
 }
 
 QT_END_NAMESPACE
@@ -52,22 +52,48 @@ extern const char *const matchTypeAttributeC;
 extern const char *const matchOffsetAttributeC;
 extern const char *const matchMaskAttributeC;
 
-class BaseMimeTypeParser
+class QMIME_EXPORT BaseMimeTypeParser
 {
     Q_DISABLE_COPY(BaseMimeTypeParser)
 
 public:
-    BaseMimeTypeParser() {}
+    BaseMimeTypeParser() : m_contents(AllContent) {}
     virtual ~BaseMimeTypeParser() {}
 
+    // Parts of the files which are processed, the others are skipped
+    enum Content {
+        MimeTypeContent = 0x1, // the types, with their icons, globs, parents and aliases
+        CommentContent = 0x2,
+        MagicContent = 0x4,
+        AllContent = MimeTypeContent | CommentContent | MagicContent
+    };
+
+    int contents() const { return m_contents; }
+    void setContents(int flags) { m_contents = flags; }
+
+    // The xml:lang values of the comments which are kept, all of them if empty
+    QSet<QString> commentLocales() const { return m_commentLocales; }
+    void setCommentLocales(const QSet<QString> &locales) { m_commentLocales = locales; }
+
     bool parse(QIODevice *dev, const QString &fileName, QString *errorMessage);
 
+    enum FastParseResult {
+        FastParseSucceeded,
+        FastParseFailed,
+        FastParseUnsupported // nothing was processed, use parse() instead
+    };
+
+    FastParseResult parseFast(const char *data, int size, const QString &fileName, QString *errorMessage);
+
 protected:
     virtual bool process(const QMimeType &t, QString *errorMessage) = 0;
     virtual bool process(const QMimeGlobPattern &t, QString *errorMessage) = 0;
     virtual void processParent(const QString& child, const QString& parent) = 0;
     virtual void processAlias(const QString& alias, const QString& name) = 0;
     virtual void processMagicMatcher(const QMimeMagicRuleMatcher& matcher) = 0;
+    // Only called instead of process(QMimeType) when reading the comments without MimeTypeContent
+    virtual void processComments(const QString &name, const QHash<QString, QString> &localeComments)
+    { Q_UNUSED(name); Q_UNUSED(localeComments); }
 
 private:
     enum ParseState {
@@ -86,7 +112,40 @@ private:
         ParseError
     };
 
-    static ParseState nextState(ParseState currentState, const QStringRef &startElement);
+    enum TagName {
+        MimeInfoTag,
+        MimeTypeTag,
+        CommentTag,
+        GenericIconTag,
+        IconTag,
+        GlobTag,
+        SubClassTag,
+        AliasTag,
+        MagicTag,
+        MatchTag,
+        OtherTag
+    };
+
+    enum ElementResult {
+        ElementOk,
+        ElementFailed, // errorMessage was set
+        ElementInvalid // the document is invalid, error was set
+    };
+
+    struct ParseData;
+
+    static TagName tagName(const QStringRef &name);
+    static TagName tagName(const char *name, int length);
+    static ParseState nextState(ParseState currentState, TagName tag);
+
+    template <typename Attributes>
+    ElementResult startElement(ParseData &pd, ParseState ps, const Attributes &atts, const QString &text,
+                               QString *errorMessage, QString *error);
+    bool endElement(ParseData &pd, TagName tag, QString *errorMessage);
+    bool skipsElement(ParseState ps) const;
+
+    int m_contents;
+    QSet<QString> m_commentLocales;
 };
 
 
@@ -111,6 +170,9 @@ protected:
     inline void processMagicMatcher(const QMimeMagicRuleMatcher& matcher)
     { m_provider.addMagicMatcher(matcher); }
 
+    inline void processComments(const QString &name, const QHash<QString, QString> &localeComments)
+    { m_provider.addComments(name, localeComments); }
+
 private:
     QMimeXMLProvider &m_provider;
 };
@@ -23,11 +23,18 @@ SOURCES += qmimedatabase.cpp \
            mimetypeparser.cpp \
            qmimemagicrule.cpp \
            qmimeglobpattern.cpp \
-           qmimeprovider.cpp
+           qmimeprovider.cpp \
+           qmimedirectorycache.cpp \
+           qmimedirectoryscanner.cpp \
+           qmimecontentreader.cpp \
+           qmimefileindex.cpp \
+           qmimenamecache.cpp
 
 the_includes.files += qmime_global.h \
                       qmimedatabase.h \
                       qmimetype.h \
+                      qmimedirectoryscanner.h \
+                      qmimefileindex.h \
 
 HEADERS += $$the_includes.files \
            qmimemagicrulematcher_p.h \
@@ -36,7 +43,12 @@ HEADERS += $$the_includes.files \
            qmimedatabase_p.h \
            qmimemagicrule_p.h \
            qmimeglobpattern_p.h \
-           qmimeprovider_p.h
+           qmimeprovider_p.h \
+           qmimedirectorycache_p.h \
+           qmimedirectoryscanner_p.h \
+           qmimecontentreader_p.h \
+           qmimefileindex_p.h \
+           qmimenamecache_p.h
 
 SOURCES += inqt5/qstandardpaths.cpp
 win32: SOURCES += inqt5/qstandardpaths_win.cpp
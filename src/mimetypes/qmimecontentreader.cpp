@@ -0,0 +1,84 @@
+/****************************************************************************
+**
+** This file is part of QMime
+**
+** Based on Qt Creator source code
+**
+** Qt Creator Copyright (c) 2011 Nokia Corporation and/or its subsidiary(-ies).
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "qmimecontentreader_p.h"
+
+#include <QtCore/QFile>
+#include <qplatformdefs.h>
+
+#ifdef Q_OS_UNIX
+#include <errno.h>
+#endif
+
+QT_BEGIN_NAMESPACE
+
+#ifdef Q_OS_UNIX
+static bool readPrefix(const QByteArray &nativePath, int prefixSize, QByteArray *content)
+{
+    const int fd = QT_OPEN(nativePath.constData(), QT_OPEN_RDONLY);
+    if (fd == -1)
+        return false;
+    content->resize(prefixSize);
+    qint64 size = 0;
+    while (size < prefixSize) {
+        const ssize_t result = ::pread(fd, content->data() + size, prefixSize - size, size);
+        if (result <= 0) {
+            if (result == -1 && errno == EINTR)
+                continue;
+            break;
+        }
+        size += result;
+    }
+    content->resize(int(size));
+    QT_CLOSE(fd);
+    return true;
+}
+#else
+static bool readPrefix(const QString &filePath, int prefixSize, QByteArray *content)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    *content = file.read(prefixSize);
+    return true;
+}
+#endif
+
+void QMimeContentReader::readPrefixes(const QStringList &filePaths, int prefixSize,
+                                      QList<QByteArray> *contents, QVector<bool> *opened)
+{
+    contents->clear();
+    for (int i = 0; i < filePaths.count(); ++i)
+        contents->append(QByteArray());
+    opened->fill(false, filePaths.count());
+
+#ifdef Q_OS_UNIX
+    QList<QByteArray> nativePaths;
+    foreach (const QString &filePath, filePaths)
+        nativePaths.append(QFile::encodeName(filePath));
+    for (int i = 0; i < nativePaths.count(); ++i)
+        (*opened)[i] = readPrefix(nativePaths.at(i), prefixSize, &(*contents)[i]);
+#else
+    for (int i = 0; i < filePaths.count(); ++i)
+        (*opened)[i] = readPrefix(filePaths.at(i), prefixSize, &(*contents)[i]);
+#endif
+}
+
+QT_END_NAMESPACE
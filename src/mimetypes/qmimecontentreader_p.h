@@ -0,0 +1,47 @@
+/****************************************************************************
+**
+** This file is part of QMime
+**
+** Based on Qt Creator source code
+**
+** Qt Creator Copyright (c) 2011 Nokia Corporation and/or its subsidiary(-ies).
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QMIMECONTENTREADER_P_H_INCLUDED
+#define QMIMECONTENTREADER_P_H_INCLUDED
+
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+QT_BEGIN_NAMESPACE
+
+// Reads the beginning of many files at once, with open and pread on Unix.
+// The files of a batch are read one after the other: the batches themselves
+// run in parallel in the threads of QMimeDirectoryScanner.
+class QMimeContentReader
+{
+public:
+    enum { PrefixSize = 16384 }; // the most findByNameAndData reads
+
+    // Sets contents[i] to the first prefixSize bytes of filePaths[i], and opened[i]
+    // to whether the file could be opened
+    static void readPrefixes(const QStringList &filePaths, int prefixSize,
+                             QList<QByteArray> *contents, QVector<bool> *opened);
+};
+
+QT_END_NAMESPACE
+
+#endif   // QMIMECONTENTREADER_P_H_INCLUDED
@@ -22,18 +22,33 @@
 
 #include "qmimedatabase_p.h"
 
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
 #include <QtCore/QFile>
 #include <QtCore/QFileInfo>
+#include <QtCore/QLocale>
 #include <QtCore/QSet>
 #include <QtCore/QBuffer>
 #include <QtCore/QUrl>
 #include <QtCore/QStack>
 #include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFutureInterface>
+#include <QtCore/QRunnable>
+#include <QtCore/QTextStream>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
 #include <qplatformdefs.h>
 
 #include <algorithm>
 #include <functional>
 
+#if defined(Q_OS_LINUX) || defined(Q_OS_MAC)
+#define QMIME_HAVE_XATTR
+#include <sys/xattr.h>
+#endif
+
 #include "qmimeprovider_p.h"
 #include "qmimetype_p.h"
 
@@ -62,8 +77,34 @@ QMimeDatabasePrivate *QMimeDatabasePrivate::instance()
 
 // ------------------------------------------------------------------------------------------------
 
+// The languages QMimeType::comment() looks for when not given one, and the
+// language of comments without xml:lang.
+static QSet<QString> defaultRetainedLocales()
+{
+    QStringList languages;
+    languages << QLocale::system().name();
+    languages << QLocale::system().uiLanguages();
+
+    QSet<QString> locales;
+    locales.insert(QLatin1String("en_US"));
+    foreach (const QString &language, languages) {
+        locales.insert(language);
+        const int pos = language.indexOf(QLatin1Char('_'));
+        if (pos != -1)
+            locales.insert(language.left(pos));
+    }
+    return locales;
+}
+
 QMimeDatabasePrivate::QMimeDatabasePrivate()
-    : m_provider(0), m_defaultMimeType(QLatin1String("application/octet-stream"))
+    : m_provider(0), m_defaultMimeType(QLatin1String("application/octet-stream")),
+      m_childrenLoaded(false), m_childrenGeneration(0),
+      m_retainedLocales(defaultRetainedLocales()),
+      m_countersEnabled(qgetenv("QT_MIME_COUNTERS").isEmpty() ? 0 : 1),
+      m_trace(0),
+      m_deadline(0),
+      m_extendedAttributeUsage(QMimeDatabase::IgnoreExtendedAttributes),
+      m_asyncPool(0)
 {
 }
 
@@ -71,12 +112,55 @@ QMimeDatabasePrivate::QMimeDatabasePrivate()
 
 QMimeDatabasePrivate::~QMimeDatabasePrivate()
 {
+    // Waits for the pending lookups, which still use the provider
+    delete m_asyncPool;
+    m_asyncPool = 0;
+
     delete m_provider;
     m_provider = 0;
 }
 
 // ------------------------------------------------------------------------------------------------
 
+/*!
+    \internal
+    Returns the languages whose MIME type comments are kept in memory. The comments
+    in other languages are read again from the XML files when asked for.
+    An empty list means that all of them are kept.
+ */
+QStringList QMimeDatabasePrivate::retainedLocales() const
+{
+    QStringList locales = retainedLocaleSet().toList();
+    locales.sort();
+    return locales;
+}
+
+/*!
+    \internal
+    Sets the languages whose comments are kept in memory to \a locales.
+    This only applies to the types which are loaded afterwards, so it should be
+    called before the database is used.
+ */
+void QMimeDatabasePrivate::setRetainedLocales(const QStringList &locales)
+{
+    QMutexLocker locker(&m_retainedLocalesMutex);
+    m_retainedLocales = locales.toSet();
+}
+
+bool QMimeDatabasePrivate::isRetainedLocale(const QString &locale) const
+{
+    QMutexLocker locker(&m_retainedLocalesMutex);
+    return m_retainedLocales.isEmpty() || m_retainedLocales.contains(locale);
+}
+
+QSet<QString> QMimeDatabasePrivate::retainedLocaleSet() const
+{
+    QMutexLocker locker(&m_retainedLocalesMutex);
+    return m_retainedLocales;
+}
+
+// ------------------------------------------------------------------------------------------------
+
 QMimeProviderBase *QMimeDatabasePrivate::provider()
 {
     if (!m_provider) {
@@ -97,6 +181,8 @@ void QMimeDatabasePrivate::setProvider(QMimeProviderBase *theProvider)
 {
     delete m_provider;
     m_provider = theProvider;
+    m_nameCache.clear();
+    m_childrenLoaded = false;
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -107,12 +193,43 @@ QMimeType QMimeDatabasePrivate::mimeTypeForName(const QString &nameOrAlias)
     return provider()->mimeTypeForName(provider()->resolveAlias(nameOrAlias));
 }
 
-QStringList QMimeDatabasePrivate::findByName(const QString &fileName, QString *foundSuffix)
+QStringList QMimeDatabasePrivate::findByName(const QString &fileName, QString *foundSuffix, int *weightPtr)
 {
-    if (fileName.endsWith(QLatin1Char('/')))
+    if (fileName.endsWith(QLatin1Char('/'))) {
+        if (weightPtr)
+            *weightPtr = QMimeGlobPattern::MaxWeight;
         return QStringList() << QLatin1String("inode/directory");
+    }
+
+#ifdef Q_OS_WIN
+    const QString name = QFileInfo(fileName).fileName();
+#else
+    const QString name = fileName.mid(fileName.lastIndexOf(QLatin1Char('/')) + 1);
+#endif
 
-    const QStringList matchingMimeTypes = provider()->findByName(QFileInfo(fileName).fileName(), foundSuffix);
+    // The traces show the real lookup
+    if (m_nameCache.capacity() == 0 || m_trace)
+        return provider()->findByName(name, foundSuffix, weightPtr);
+
+    const QString key = m_nameCache.key(provider(), name);
+    QStringList matchingMimeTypes;
+    if (!key.isEmpty() && m_nameCache.find(key, &matchingMimeTypes, foundSuffix, weightPtr)) {
+        if (countersEnabled())
+            ++m_counters.nameCacheHits;
+        return matchingMimeTypes;
+    }
+    if (countersEnabled())
+        ++m_counters.nameCacheMisses;
+
+    QString suffix;
+    int weight = 0;
+    matchingMimeTypes = provider()->findByName(name, &suffix, &weight);
+    if (!key.isEmpty())
+        m_nameCache.insert(key, matchingMimeTypes, suffix, weight);
+    if (foundSuffix)
+        *foundSuffix = suffix;
+    if (weightPtr)
+        *weightPtr = weight;
     return matchingMimeTypes;
 }
 
@@ -152,7 +269,16 @@ QMimeType QMimeDatabasePrivate::findByData(const QByteArray &data, int *accuracy
     if (candidate.isValid())
         return candidate;
 
+    // The deadline cut magic short, a rule which wasn't evaluated may have matched
+    if (m_deadline && m_deadline->isProvisional())
+        return QMimeType();
+
+    QMimeTraceStage stage(m_trace, "textCheck");
+    stage.addRulesTried(1);
+    stage.addBytesExamined(qMin(32, data.size()));
     if (isTextFile(data)) {
+        if (stage.isActive())
+            stage.addCandidate(QLatin1String("text/plain"), 5, QLatin1String("text"));
         *accuracyPtr = 5;
         return mimeTypeForName(QLatin1String("text/plain"));
     }
@@ -162,7 +288,48 @@ QMimeType QMimeDatabasePrivate::findByData(const QByteArray &data, int *accuracy
 
 // ------------------------------------------------------------------------------------------------
 
-QMimeType QMimeDatabasePrivate::findByNameAndData(const QString &fileName, QIODevice *device, int *accuracyPtr)
+// Returns how many bytes of contents to read, at most \a maxSize: only as many
+// as the magic rules look at
+int QMimeDatabasePrivate::contentsSize(int maxSize)
+{
+    // The text check looks at the first 32 bytes
+    const int extent = provider()->magicMaxExtent();
+    if (extent > 0)
+        maxSize = qMin(maxSize, qMax(extent, 32));
+    return maxSize;
+}
+
+// Returns at most \a maxSize bytes from the start of \a device, only as many as the
+// magic rules look at, without consuming them: peek() seeks back random-access
+// devices, and keeps the data in the buffer of sequential ones.
+QByteArray QMimeDatabasePrivate::peekContents(QIODevice *device, int maxSize)
+{
+    maxSize = contentsSize(maxSize);
+
+    QByteArray data = device->peek(maxSize);
+    if (m_deadline && device->isSequential()) {
+        // Waits for more data until the deadline, which then leaves the result provisional
+        while (data.size() < maxSize) {
+            if (m_deadline->hasExpired() || !device->waitForReadyRead(m_deadline->remainingTime())) {
+                m_deadline->hasExpired();
+                break;
+            }
+            const QByteArray more = device->peek(maxSize);
+            if (more.size() <= data.size())
+                break;
+            data = more;
+        }
+    }
+
+    if (countersEnabled()) {
+        ++m_counters.deviceReads;
+        m_counters.bytesRead += data.size();
+    }
+    return data;
+}
+
+QMimeType QMimeDatabasePrivate::findByNameAndData(const QString &fileName, QIODevice *device, int *accuracyPtr,
+                                                  const QMimeLookupOptions &options)
 {
     // First, glob patterns are evaluated. If there is a match with max weight,
     // this one is selected and we are done. Otherwise, the file contents are
@@ -172,28 +339,53 @@ QMimeType QMimeDatabasePrivate::findByNameAndData(const QString &fileName, QIODe
     *accuracyPtr = 0;
 
     // Pass 1) Try to match on the file name
-    QStringList candidatesByName = findByName(fileName);
+    int weight = 0;
+    QStringList candidatesByName = findByName(fileName, 0, &weight);
     if (candidatesByName.count() == 1) {
         *accuracyPtr = 100;
         const QMimeType mime = mimeTypeForName(candidatesByName.at(0));
-        if (mime.isValid())
+        if (!mime.isValid()) {
+            candidatesByName.clear();
+        } else if (weight >= options.conclusiveGlobWeight) {
+            if (countersEnabled())
+                ++m_counters.contentReadsAvoided;
             return mime;
-        candidatesByName.clear();
+        }
     }
 
-    // Extension is unknown, or matches multiple mimetypes.
-    // Pass 2) Match on content, if we can read the data
-    if (device->isOpen() || device->open(QIODevice::ReadOnly)) {
+    // Extension is unknown, matches multiple mimetypes, or with a too low weight.
+    // Pass 2) Match on content, if allowed, if there is time left and if we can read the data
+    if (options.readContent && options.maxBytesRead > 0
+            && !(m_deadline && m_deadline->hasExpired())
+            && (device->isOpen() || device->open(QIODevice::ReadOnly))) {
 
-        // Read 16K in one go (QIODEVICE_BUFFERSIZE in qiodevice_p.h).
+        // Peek up to 16K (by default) in one go (QIODEVICE_BUFFERSIZE in qiodevice_p.h).
         // This is much faster than seeking back and forth into QIODevice.
-        const QByteArray data = device->read(16384);
+        QByteArray data;
+        {
+            QMimeTraceStage stage(m_trace, "readContents");
+            data = peekContents(device, options.maxBytesRead);
+            stage.addBytesExamined(data.size());
+        }
 
+        // Only the magic which can choose between the candidates first, then all of it
         int magicAccuracy = 0;
-        QMimeType candidateByData(findByData(data, &magicAccuracy));
+        QMimeType candidateByData;
+        if (!data.isEmpty() && !candidatesByName.isEmpty())
+            candidateByData = provider()->findByMagicAmong(data, &magicAccuracy, magicCandidates(candidatesByName));
+        // Nothing read before the deadline doesn't make it an empty file
+        if (!candidateByData.isValid() && (!data.isEmpty() || !(m_deadline && m_deadline->isProvisional())))
+            candidateByData = findByData(data, &magicAccuracy);
+
+        // When the deadline cut magic short, what it found so far doesn't overrule the name
+        const bool magicCutShort = m_deadline && m_deadline->isProvisional();
+        if (magicCutShort && candidatesByName.isEmpty() && candidateByData.isValid()) {
+            *accuracyPtr = magicAccuracy;
+            return candidateByData;
+        }
 
         // Disambiguate conflicting extensions (if magic found something and the magicrule was < 80)
-        if (candidateByData.isValid() && magicAccuracy > 0) {
+        if (!magicCutShort && candidateByData.isValid() && magicAccuracy > 0) {
             // "for glob_match in glob_matches:"
             // "if glob_match is subclass or equal to sniffed_type, use glob_match"
             const QString sniffedMime = candidateByData.name();
@@ -209,8 +401,8 @@ QMimeType QMimeDatabasePrivate::findByNameAndData(const QString &fileName, QIODe
         }
     }
 
-    if (candidatesByName.count() > 1) {
-        *accuracyPtr = 20;
+    if (!candidatesByName.isEmpty()) {
+        *accuracyPtr = candidatesByName.count() > 1 ? 20 : 100;
         candidatesByName.sort(); // to make it deterministic
         const QMimeType mime = mimeTypeForName(candidatesByName.at(0));
         if (mime.isValid())
@@ -244,6 +436,96 @@ QList<QMimeType> QMimeDatabasePrivate::allMimeTypes()
     return provider()->allMimeTypes();
 }
 
+QStringList QMimeDatabasePrivate::allMimeTypeNames()
+{
+    return provider()->allMimeTypeNames();
+}
+
+QMimeDatabaseStatistics QMimeDatabasePrivate::statistics()
+{
+    QMimeDatabaseStatistics stats;
+    provider()->addStatistics(stats);
+    stats.cacheBytes += m_directoryCache.memoryUsage();
+    return stats;
+}
+
+static int latencyBucket(qint64 usecs)
+{
+    int bucket = 0;
+    while (usecs > 0 && bucket < QMimeDatabaseCounters::HistogramBuckets - 1) {
+        usecs >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+void QMimeDatabasePrivate::recordCall(QMimeDatabaseCounters::Operation operation, qint64 usecs)
+{
+    ++m_counters.calls[operation];
+    ++m_counters.latencyHistogram[operation][latencyBucket(usecs)];
+}
+
+// Locks the database for one lookup, and when the counters are enabled, records
+// how long it waited for the lock and how long the lookup took.
+class QMimeLookupLocker
+{
+public:
+    QMimeLookupLocker(QMimeDatabasePrivate *d, QMimeDatabaseCounters::Operation operation)
+        : m_d(d), m_operation(operation), m_measured(d->countersEnabled())
+    {
+        if (m_measured)
+            m_timer.start();
+        m_d->mutex.lock();
+        if (m_measured)
+            m_d->m_counters.lockWaitTime += m_timer.nsecsElapsed() / 1000;
+    }
+
+    ~QMimeLookupLocker()
+    {
+        if (m_measured && m_d->countersEnabled())
+            m_d->recordCall(m_operation, m_timer.nsecsElapsed() / 1000);
+        m_d->mutex.unlock();
+    }
+
+private:
+    Q_DISABLE_COPY(QMimeLookupLocker)
+
+    QMimeDatabasePrivate *m_d;
+    const QMimeDatabaseCounters::Operation m_operation;
+    const bool m_measured;
+    QElapsedTimer m_timer;
+};
+
+// ------------------------------------------------------------------------------------------------
+
+QMimeTraceStage::QMimeTraceStage(QMimeLookupTrace *trace, const char *name)
+    : m_trace(trace)
+{
+    if (m_trace) {
+        m_stage.name = QLatin1String(name);
+        m_timer.start();
+    }
+}
+
+QMimeTraceStage::~QMimeTraceStage()
+{
+    if (m_trace) {
+        m_stage.time = m_timer.nsecsElapsed();
+        m_trace->stages.append(m_stage);
+    }
+}
+
+void QMimeTraceStage::addCandidate(const QString &mimeType, int weight, const QString &rule)
+{
+    if (!m_trace)
+        return;
+    QMimeLookupTrace::Candidate candidate;
+    candidate.mimeType = mimeType;
+    candidate.weight = weight;
+    candidate.rule = rule;
+    m_stage.candidates.append(candidate);
+}
+
 // ------------------------------------------------------------------------------------------------
 
 bool QMimeDatabasePrivate::inherits(const QString &mime, const QString &parent)
@@ -263,6 +545,111 @@ bool QMimeDatabasePrivate::inherits(const QString &mime, const QString &parent)
     return false;
 }
 
+// Changes with the MIME database on disk: the path, modification time and size of
+// the mime.cache files and of the package files. Unlike the generation of the
+// directory cache, it is the same in every process, so it can be saved.
+// Doesn't need the database locked.
+QByteArray QMimeDatabasePrivate::fingerprint()
+{
+    QStringList files = m_directoryCache.locateAll(QLatin1String("mime.cache"));
+    foreach (const QString &packageDir, m_directoryCache.locateAllDirectories(QLatin1String("packages"))) {
+        foreach (const QString &name, QDir(packageDir).entryList(QDir::Files, QDir::Name))
+            files.append(packageDir + QLatin1Char('/') + name);
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    foreach (const QString &file, files) {
+        const QFileInfo fileInfo(file);
+        QByteArray line = QFile::encodeName(file);
+        line += ' ';
+        line += QByteArray::number(fileInfo.lastModified().toMSecsSinceEpoch());
+        line += ' ';
+        line += QByteArray::number(fileInfo.size());
+        line += '\n';
+        hash.addData(line);
+    }
+    return hash.result();
+}
+
+// The reverse of QMimeProviderBase::parents()
+const QHash<QString, QStringList> &QMimeDatabasePrivate::children()
+{
+    const int generation = m_directoryCache.generation();
+    if (m_childrenLoaded && generation == m_childrenGeneration)
+        return m_children;
+
+    m_children.clear();
+    foreach (const QString &name, provider()->allMimeTypeNames()) {
+        foreach (const QString &parent, provider()->parents(name))
+            m_children[parent].append(name);
+    }
+    m_childrenGeneration = generation;
+    m_childrenLoaded = true;
+    return m_children;
+}
+
+// The types whose magic can choose between the glob candidates: the candidates,
+// their ancestors (a candidate inheriting the sniffed type is used) and their
+// descendants (a sniffed type more specific than the candidates is used).
+QSet<QString> QMimeDatabasePrivate::magicCandidates(const QStringList &candidatesByName)
+{
+    QSet<QString> result;
+    QStack<QString> toCheck;
+    foreach (const QString &mime, candidatesByName)
+        toCheck.push(mime);
+    while (!toCheck.isEmpty()) {
+        const QString current = toCheck.pop();
+        if (result.contains(current))
+            continue;
+        result.insert(current);
+        foreach (const QString &parent, provider()->parents(current))
+            toCheck.push(parent);
+    }
+
+    const QHash<QString, QStringList> &childrenHash = children();
+    foreach (const QString &mime, candidatesByName)
+        toCheck.push(mime);
+    while (!toCheck.isEmpty()) {
+        foreach (const QString &child, childrenHash.value(toCheck.pop())) {
+            if (!result.contains(child)) {
+                result.insert(child);
+                toCheck.push(child);
+            }
+        }
+    }
+    return result;
+}
+
+// ------------------------------------------------------------------------------------------------
+
+/*!
+    \class QMimeLookupOptions
+    \brief The QMimeLookupOptions structure controls how much the lookups of a file may read.
+
+    By default, the lookups read the first 16K of the file contents when its name
+    doesn't tell the MIME type, follow symbolic links, and trust any glob pattern
+    matching the name alone. Callers for which latency matters more than accuracy
+    can restrict that.
+
+    \list
+    \o maxBytesRead: how much of the contents is read for magic matching.
+       Less data can only match the magic rules looking at the start of the file.
+    \o readContent: false to find the MIME type from the name only,
+       like QMimeDatabase::findByName() does.
+    \o followSymlinks: false to return inode/symlink for symbolic links.
+    \o conclusiveGlobWeight: the minimum weight of a single matching glob pattern
+       for the contents not to be read. 0 (the default) trusts every pattern; 51
+       would only trust patterns with a higher weight than the "*.ext" ones.
+    \endlist
+
+    \sa QMimeDatabase::findByFile()
+*/
+
+QMimeLookupOptions::QMimeLookupOptions()
+    : maxBytesRead(16384), readContent(true), followSymlinks(true), conclusiveGlobWeight(0)
+{
+}
+
 // ------------------------------------------------------------------------------------------------
 
 /*!
@@ -349,6 +736,100 @@ QMimeType QMimeDatabase::mimeTypeForName(const QString& nameOrAlias) const
 
 // ------------------------------------------------------------------------------------------------
 
+#ifdef QMIME_HAVE_XATTR
+
+// The attribute defined by the shared-mime-info spec, set by the user or by us
+static const char mimeTypeAttribute[] = "user.mime_type";
+// Only set along with a detected type: the modification time and size of
+// the file it was detected for. A type set by the user has no stamp.
+static const char mimeTypeStampAttribute[] = "user.mime_type_stamp";
+
+static QByteArray readAttribute(const QByteArray &nativeFilePath, const char *name)
+{
+    char buffer[256];
+#ifdef Q_OS_MAC
+    const ssize_t size = ::getxattr(nativeFilePath.constData(), name, buffer, sizeof(buffer), 0, 0);
+#else
+    const ssize_t size = ::getxattr(nativeFilePath.constData(), name, buffer, sizeof(buffer));
+#endif
+    return size > 0 ? QByteArray(buffer, size) : QByteArray();
+}
+
+static bool writeAttribute(const QByteArray &nativeFilePath, const char *name, const QByteArray &value)
+{
+#ifdef Q_OS_MAC
+    return ::setxattr(nativeFilePath.constData(), name, value.constData(), value.size(), 0, 0) == 0;
+#else
+    return ::setxattr(nativeFilePath.constData(), name, value.constData(), value.size(), 0) == 0;
+#endif
+}
+
+static void removeAttribute(const QByteArray &nativeFilePath, const char *name)
+{
+#ifdef Q_OS_MAC
+    ::removexattr(nativeFilePath.constData(), name, 0);
+#else
+    ::removexattr(nativeFilePath.constData(), name);
+#endif
+}
+
+static QByteArray modificationStamp(const QByteArray &nativeFilePath)
+{
+    QT_STATBUF statBuffer;
+    if (QT_STAT(nativeFilePath.constData(), &statBuffer) != 0)
+        return QByteArray();
+    QByteArray stamp = QByteArray::number(qint64(statBuffer.st_mtime));
+    stamp += '.';
+#ifdef Q_OS_MAC
+    stamp += QByteArray::number(qint64(statBuffer.st_mtimespec.tv_nsec));
+#else
+    stamp += QByteArray::number(qint64(statBuffer.st_mtim.tv_nsec));
+#endif
+    stamp += ' ';
+    stamp += QByteArray::number(qint64(statBuffer.st_size));
+    return stamp;
+}
+
+#endif
+
+// Reads the attributes of the file before the lookup, without the database
+// locked, so that a slow filesystem doesn't hold up the other lookups.
+static void readFileAttributes(QMimeDatabasePrivate *d, const QFileInfo &fileInfo,
+                               QMimeFileAttributes *attributes)
+{
+#ifdef QMIME_HAVE_XATTR
+    if (d->extendedAttributeUsage() == QMimeDatabase::IgnoreExtendedAttributes)
+        return;
+    attributes->read = true;
+    attributes->nativeFilePath = QFile::encodeName(fileInfo.absoluteFilePath());
+    attributes->stamp = modificationStamp(attributes->nativeFilePath);
+    attributes->recordedName = readAttribute(attributes->nativeFilePath, mimeTypeAttribute);
+    if (!attributes->recordedName.isEmpty())
+        attributes->recordedStamp = readAttribute(attributes->nativeFilePath, mimeTypeStampAttribute);
+#else
+    Q_UNUSED(d);
+    Q_UNUSED(fileInfo);
+    Q_UNUSED(attributes);
+#endif
+}
+
+// Records the type detected by the lookup, if any, once the database is unlocked again
+static void writeFileAttributes(const QMimeFileAttributes &attributes)
+{
+#ifdef QMIME_HAVE_XATTR
+    if (attributes.detectedName.isEmpty())
+        return;
+    // The stamp goes first, so that the type is never taken for one set by the user
+    if (writeAttribute(attributes.nativeFilePath, mimeTypeStampAttribute, attributes.stamp)
+            && !writeAttribute(attributes.nativeFilePath, mimeTypeAttribute, attributes.detectedName))
+        removeAttribute(attributes.nativeFilePath, mimeTypeStampAttribute);
+#else
+    Q_UNUSED(attributes);
+#endif
+}
+
+// ------------------------------------------------------------------------------------------------
+
 /*!
     \fn QMimeType QMimeDatabase::findByFile(const QFileInfo &fileInfo) const;
     \brief Returns a MIME type for \a fileInfo.
@@ -368,13 +849,42 @@ QMimeType QMimeDatabase::mimeTypeForName(const QString& nameOrAlias) const
     \sa isDefault
 */
 QMimeType QMimeDatabase::findByFile(const QFileInfo &fileInfo) const
+{
+    // Implemented as a wrapper around findByFile(QFileInfo, QMimeLookupOptions), so no mutex.
+    return findByFile(fileInfo, QMimeLookupOptions());
+}
+
+/*!
+    Returns a MIME type for \a fileInfo, looking at the file as allowed by \a options.
+
+    \sa findByFile(), QMimeLookupOptions
+*/
+QMimeType QMimeDatabase::findByFile(const QFileInfo &fileInfo, const QMimeLookupOptions &options) const
 {
     DBG() << "fileInfo" << fileInfo.absoluteFilePath();
 
-    QMutexLocker locker(&d->mutex);
+    QMimeFileAttributes attributes;
+    readFileAttributes(d, fileInfo, &attributes);
+    QMimeType result;
+    {
+        QMimeLookupLocker locker(d, QMimeDatabaseCounters::FindByNameAndData);
 
+        int accuracy = 0;
+        result = d->findByFile(fileInfo, &accuracy, options, &attributes);
+    }
+    writeFileAttributes(attributes);
+    return result;
+}
+
+QMimeType QMimeDatabasePrivate::findByFile(const QFileInfo &fileInfo, int *accuracyPtr,
+                                           const QMimeLookupOptions &options,
+                                           QMimeFileAttributes *attributes)
+{
+    *accuracyPtr = 100;
+    if (!options.followSymlinks && fileInfo.isSymLink())
+        return mimeTypeForName(QLatin1String("inode/symlink"));
     if (fileInfo.isDir())
-        return d->mimeTypeForName(QLatin1String("inode/directory"));
+        return mimeTypeForName(QLatin1String("inode/directory"));
 
     QFile file(fileInfo.absoluteFilePath());
 
@@ -384,20 +894,66 @@ QMimeType QMimeDatabase::findByFile(const QFileInfo &fileInfo) const
     QT_STATBUF statBuffer;
     if (QT_LSTAT(nativeFilePath.constData(), &statBuffer) == 0) {
         if (S_ISCHR(statBuffer.st_mode))
-            return d->mimeTypeForName(QLatin1String("inode/chardevice"));
+            return mimeTypeForName(QLatin1String("inode/chardevice"));
         if (S_ISBLK(statBuffer.st_mode))
-            return d->mimeTypeForName(QLatin1String("inode/blockdevice"));
+            return mimeTypeForName(QLatin1String("inode/blockdevice"));
         if (S_ISFIFO(statBuffer.st_mode))
-            return d->mimeTypeForName(QLatin1String("inode/fifo"));
+            return mimeTypeForName(QLatin1String("inode/fifo"));
         if (S_ISSOCK(statBuffer.st_mode))
-            return d->mimeTypeForName(QLatin1String("inode/socket"));
+            return mimeTypeForName(QLatin1String("inode/socket"));
     }
+
+#ifdef QMIME_HAVE_XATTR
+    if (attributes && attributes->read)
+        return findByFileWithAttributes(fileInfo.absoluteFilePath(), &file, accuracyPtr, options, attributes);
+#endif
 #endif
 
-    int priority = 0;
-    return d->findByNameAndData(fileInfo.absoluteFilePath(), &file, &priority);
+    return findByNameAndData(fileInfo.absoluteFilePath(), &file, accuracyPtr, options);
+}
+
+#ifdef QMIME_HAVE_XATTR
+
+// Uses the type recorded in the extended attributes of the file, if it is
+// still valid, and picks the detected type to record when the contents had to
+// be read. The attributes themselves are read and written without the database
+// locked, by the callers.
+QMimeType QMimeDatabasePrivate::findByFileWithAttributes(const QString &fileName, QFile *file,
+                                                         int *accuracyPtr, const QMimeLookupOptions &options,
+                                                         QMimeFileAttributes *attributes)
+{
+    // A type without a stamp was set by the user
+    const bool setByUser = !attributes->recordedName.isEmpty() && attributes->recordedStamp.isEmpty();
+    {
+        QMimeTraceStage stage(m_trace, "extendedAttributes");
+        stage.addRulesTried(1);
+        if (setByUser || (!attributes->recordedName.isEmpty() && attributes->recordedStamp == attributes->stamp)) {
+            const QMimeType mime = mimeTypeForName(QString::fromUtf8(attributes->recordedName.constData(),
+                                                                     attributes->recordedName.size()));
+            if (mime.isValid()) {
+                if (stage.isActive())
+                    stage.addCandidate(mime.name(), 100, QLatin1String(mimeTypeAttribute));
+                if (countersEnabled())
+                    ++m_counters.contentReadsAvoided;
+                *accuracyPtr = 100;
+                return mime;
+            }
+        }
+    }
+
+    const QMimeType mime = findByNameAndData(fileName, file, accuracyPtr, options);
+
+    // Only worth recording when the contents had to be read, and were fully looked at.
+    // A type set by the user is kept, even one which isn't in this database.
+    if (extendedAttributeUsage() == QMimeDatabase::ReadWriteExtendedAttributes
+            && !setByUser && file->isOpen() && !attributes->stamp.isEmpty()
+            && !(m_deadline && m_deadline->isProvisional()))
+        attributes->detectedName = mime.name().toUtf8();
+    return mime;
 }
 
+#endif
+
 // ------------------------------------------------------------------------------------------------
 
 /*!
@@ -422,6 +978,54 @@ QMimeType QMimeDatabase::findByFile(const QString &fileName) const
     return findByFile(fileInfo);
 }
 
+/*!
+    Returns a MIME type for \a fileName, looking at the file as allowed by \a options.
+
+    \sa findByFile(), QMimeLookupOptions
+*/
+QMimeType QMimeDatabase::findByFile(const QString &fileName, const QMimeLookupOptions &options) const
+{
+    // Implemented as a wrapper around findByFile(QFileInfo, QMimeLookupOptions), so no mutex.
+    QFileInfo fileInfo(fileName);
+    return findByFile(fileInfo, options);
+}
+
+/*!
+    Returns a MIME type for \a fileName, within \a msecs milliseconds,
+    the wait for the database included. If \a msecs is -1, there is no time limit.
+
+    The stages of the lookup still to come when the time runs out are skipped,
+    and the best match found so far is returned: the one found from the
+    file name, or if the name matches nothing, a magic rule which matched
+    before the time ran out. The contents aren't guessed to be plain text then.
+    \a provisional is then set to true, and to false otherwise.
+
+    \sa findByFile(), QMimeLookupOptions
+*/
+QMimeType QMimeDatabase::findByFile(const QString &fileName, int msecs, bool *provisional,
+                                    const QMimeLookupOptions &options) const
+{
+    DBG() << "fileName" << fileName;
+
+    QMimeLookupDeadline deadline(msecs);
+    const QFileInfo fileInfo(fileName);
+    QMimeFileAttributes attributes;
+    readFileAttributes(d, fileInfo, &attributes);
+    QMimeType result;
+    {
+        QMimeLookupLocker locker(d, QMimeDatabaseCounters::FindByNameAndData);
+
+        d->m_deadline = &deadline;
+        int accuracy = 0;
+        result = d->findByFile(fileInfo, &accuracy, options, &attributes);
+        d->m_deadline = 0;
+    }
+    writeFileAttributes(attributes);
+    if (provisional)
+        *provisional = deadline.isProvisional();
+    return result;
+}
+
 // ------------------------------------------------------------------------------------------------
 
 /*!
@@ -438,18 +1042,27 @@ QMimeType QMimeDatabase::findByFile(const QString &fileName) const
 */
 QMimeType QMimeDatabase::findByName(const QString &fileName) const
 {
-    QMutexLocker locker(&d->mutex);
+    QMimeLookupLocker locker(d, QMimeDatabaseCounters::FindByName);
+
+    int accuracy = 0;
+    return d->mimeTypeForFileName(fileName, &accuracy);
+}
 
-    QStringList matches = d->findByName(fileName);
+QMimeType QMimeDatabasePrivate::mimeTypeForFileName(const QString &fileName, int *accuracyPtr)
+{
+    QStringList matches = findByName(fileName);
     const int matchCount = matches.count();
-    if (matchCount == 0)
-        return d->mimeTypeForName(d->defaultMimeType());
-    else if (matchCount == 1)
-        return d->mimeTypeForName(matches.first());
-    else {
+    if (matchCount == 0) {
+        *accuracyPtr = 0;
+        return mimeTypeForName(defaultMimeType());
+    } else if (matchCount == 1) {
+        *accuracyPtr = 100;
+        return mimeTypeForName(matches.first());
+    } else {
         // We have to pick one.
+        *accuracyPtr = 20;
         matches.sort(); // Make it deterministic
-        return d->mimeTypeForName(matches.first());
+        return mimeTypeForName(matches.first());
     }
 }
 
@@ -480,7 +1093,7 @@ QString QMimeDatabase::suffixForFileName(const QString &fileName) const
 */
 QMimeType QMimeDatabase::findByData(const QByteArray &data) const
 {
-    QMutexLocker locker(&d->mutex);
+    QMimeLookupLocker locker(d, QMimeDatabaseCounters::FindByData);
 
     int accuracy = 0;
     return d->findByData(data, &accuracy);
@@ -494,19 +1107,33 @@ QMimeType QMimeDatabase::findByData(const QByteArray &data) const
     A valid MIME type is always returned. If \a data doesn't match any
     known MIME type data, the default MIME type (application/octet-stream)
     is returned.
+
+    The data is peeked, not read: the position of a random-access device is
+    unchanged, and a sequential device, like a socket or a process, still
+    has the data to be read.
 */
 QMimeType QMimeDatabase::findByData(QIODevice* device) const
 {
-    QMutexLocker locker(&d->mutex);
+    return findByData(device, QMimeLookupOptions());
+}
+
+/*!
+    Returns a MIME type for the data in \a device, reading at most
+    QMimeLookupOptions::maxBytesRead bytes of \a options.
+
+    If the options don't allow reading the contents, the default MIME type is returned.
+*/
+QMimeType QMimeDatabase::findByData(QIODevice *device, const QMimeLookupOptions &options) const
+{
+    QMimeLookupLocker locker(d, QMimeDatabaseCounters::FindByData);
 
     int accuracy = 0;
-    if (device->isOpen() || device->open(QIODevice::ReadOnly)) {
-        // Read 16K in one go (QIODEVICE_BUFFERSIZE in qiodevice_p.h).
-        // This is much faster than seeking back and forth into QIODevice.
-        const QByteArray data = device->read(16384);
+    if (options.readContent && options.maxBytesRead > 0
+            && (device->isOpen() || device->open(QIODevice::ReadOnly))) {
+        const QByteArray data = d->peekContents(device, options.maxBytesRead);
         return d->findByData(data, &accuracy);
     }
-    return mimeTypeForName(d->defaultMimeType());
+    return d->mimeTypeForName(d->defaultMimeType());
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -523,14 +1150,24 @@ QMimeType QMimeDatabase::findByData(QIODevice* device) const
     is returned.
 */
 QMimeType QMimeDatabase::findByUrl(const QUrl &url) const
+{
+    return findByUrl(url, QMimeLookupOptions());
+}
+
+/*!
+    Returns a MIME type for \a url, looking at local files as allowed by \a options.
+
+    \sa findByUrl(), QMimeLookupOptions
+*/
+QMimeType QMimeDatabase::findByUrl(const QUrl &url, const QMimeLookupOptions &options) const
 {
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 0, 0))
     if (url.isLocalFile())
-        return findByFile(url.toLocalFile());
+        return findByFile(url.toLocalFile(), options);
 #else
     QString localFile(url.toLocalFile());
     if (!localFile.isEmpty())
-        return findByFile(localFile);
+        return findByFile(localFile, options);
 #endif
 
     const QString scheme = url.scheme();
@@ -557,13 +1194,56 @@ QMimeType QMimeDatabase::findByUrl(const QUrl &url) const
     if necessary. The file extension has priority over the contents,
     but the contents will be used if the file extension is unknown, or
     matches multiple MIME types.
+
+    Like findByData(QIODevice *), this doesn't consume the data of \a device.
 */
 QMimeType QMimeDatabase::findByNameAndData(const QString &fileName, QIODevice *device) const
+{
+    return findByNameAndData(fileName, device, QMimeLookupOptions());
+}
+
+/*!
+    Returns a MIME type for the given \a fileName and \a device data,
+    reading the device as allowed by \a options.
+
+    \sa findByNameAndData(), QMimeLookupOptions
+*/
+QMimeType QMimeDatabase::findByNameAndData(const QString &fileName, QIODevice *device,
+                                           const QMimeLookupOptions &options) const
+{
+    DBG() << "fileName" << fileName;
+
+    QMimeLookupLocker locker(d, QMimeDatabaseCounters::FindByNameAndData);
+
+    int accuracy = 0;
+    return d->findByNameAndData(fileName, device, &accuracy, options);
+}
+
+/*!
+    Returns a MIME type for the given \a fileName and \a device data,
+    within \a msecs milliseconds. If \a msecs is -1, there is no time limit.
+
+    When the time runs out, for instance while waiting for the data of a
+    sequential device, the best match found so far is returned, as for
+    findByFile(), and \a provisional is set to true. Otherwise it is set to false.
+
+    \sa findByFile(const QString &, int, bool *, const QMimeLookupOptions &) const
+*/
+QMimeType QMimeDatabase::findByNameAndData(const QString &fileName, QIODevice *device, int msecs,
+                                           bool *provisional, const QMimeLookupOptions &options) const
 {
     DBG() << "fileName" << fileName;
 
+    QMimeLookupDeadline deadline(msecs);
+    QMimeLookupLocker locker(d, QMimeDatabaseCounters::FindByNameAndData);
+
+    d->m_deadline = &deadline;
     int accuracy = 0;
-    return d->findByNameAndData(fileName, device, &accuracy);
+    const QMimeType result = d->findByNameAndData(fileName, device, &accuracy, options);
+    d->m_deadline = 0;
+    if (provisional)
+        *provisional = deadline.isProvisional();
+    return result;
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -588,6 +1268,8 @@ QMimeType QMimeDatabase::findByNameAndData(const QString &fileName, const QByteA
 {
     DBG() << "fileName" << fileName;
 
+    QMimeLookupLocker locker(d, QMimeDatabaseCounters::FindByNameAndData);
+
     QBuffer buffer(const_cast<QByteArray *>(&data));
     int accuracy = 0;
     return d->findByNameAndData(fileName, &buffer, &accuracy);
@@ -596,11 +1278,266 @@ QMimeType QMimeDatabase::findByNameAndData(const QString &fileName, const QByteA
 // ------------------------------------------------------------------------------------------------
 
 /*!
-    Returns the list of all available MIME types.
+    Returns the languages whose MIME type comments are kept in memory, sorted.
+    The comments in the other languages are read again from the XML files when
+    QMimeType::comment() asks for them. An empty list means that all of them are kept.
+
+    By default, these are the languages of the system locale and of the user
+    interface, and "en_US".
+
+    \sa setRetainedLocales()
+*/
+QStringList QMimeDatabase::retainedLocales() const
+{
+    return d->retainedLocales();
+}
+
+/*!
+    Sets the languages whose MIME type comments are kept in memory to \a locales,
+    for instance "fr" and "fr_CA". An empty list keeps all of them.
+
+    This only applies to the types loaded afterwards, so it should be called
+    before the database is used.
+
+    \sa retainedLocales()
+*/
+void QMimeDatabase::setRetainedLocales(const QStringList &locales)
+{
+    d->setRetainedLocales(locales);
+}
+
+// ------------------------------------------------------------------------------------------------
+
+/*!
+    Returns how many file extensions the glob matching results are cached for,
+    0 (the default) if they aren't cached.
+
+    \sa setNameCacheSize()
+*/
+int QMimeDatabase::nameCacheSize() const
+{
+    QMutexLocker locker(&d->mutex);
+
+    return d->m_nameCache.capacity();
+}
+
+/*!
+    Caches the glob matching results of the \a size most recently used file
+    extensions, or disables the cache if \a size is 0.
+
+    The results are cached under the part of the file names from their first
+    dot, like ".tar.gz", so this helps when many files with few different
+    extensions are looked up by name. The names matched by patterns which
+    depend on more than the extension, like "README*", are not cached.
+    This affects all the QMimeDatabase instances.
+
+    \sa QMimeDatabaseCounters
+*/
+void QMimeDatabase::setNameCacheSize(int size)
+{
+    QMutexLocker locker(&d->mutex);
+
+    d->m_nameCache.setCapacity(size);
+}
+
+/*!
+    \enum QMimeDatabase::ExtendedAttributeUsage
+
+    Controls whether findByFile() uses the \c user.mime_type extended attribute
+    of the files, as described by the shared-mime-info spec.
+
+    \value IgnoreExtendedAttributes The attributes are neither read nor written (default).
+    \value ReadExtendedAttributes A type recorded in the attribute is returned
+            without reading the file.
+    \value ReadWriteExtendedAttributes Also records the type of the files whose
+            contents had to be read, along with their modification time and size,
+            so that unchanged files don't have to be read again.
+
+    A type set by the user is always used, a recorded one only while the
+    file is unchanged. The attributes are only supported on Linux and Mac OS X.
+*/
+
+/*!
+    Returns how findByFile() uses extended attributes.
+*/
+QMimeDatabase::ExtendedAttributeUsage QMimeDatabase::extendedAttributeUsage() const
+{
+    return d->extendedAttributeUsage();
+}
+
+/*!
+    Sets how findByFile() uses extended attributes to \a usage.
+    This affects all the QMimeDatabase instances.
+*/
+void QMimeDatabase::setExtendedAttributeUsage(ExtendedAttributeUsage usage)
+{
+    qMimeAtomicStore(d->m_extendedAttributeUsage, usage);
+}
+
+// ------------------------------------------------------------------------------------------------
+
+// Called with the database locked. The pool is created on first use, with
+// QThread::idealThreadCount() threads, but at most 4: the lookups mostly wait
+// for the disk and for the database lock.
+QThreadPool *QMimeDatabasePrivate::asyncPool()
+{
+    if (!m_asyncPool) {
+        m_asyncPool = new QThreadPool;
+        m_asyncPool->setMaxThreadCount(qBound(1, QThread::idealThreadCount(), 4));
+    }
+    return m_asyncPool;
+}
+
+// Runs one lookup of the findBy*Async methods in the pool of the database
+class QMimeLookupTask : public QRunnable
+{
+public:
+    QMimeLookupTask(QMimeDatabasePrivate *d, const QString &fileName)
+        : m_d(d), m_isFile(true), m_fileName(fileName) { m_futureInterface.reportStarted(); }
+    QMimeLookupTask(QMimeDatabasePrivate *d, const QByteArray &data)
+        : m_d(d), m_isFile(false), m_data(data) { m_futureInterface.reportStarted(); }
+
+    QFuture<QMimeType> future() { return m_futureInterface.future(); }
+
+    void run()
+    {
+        // Cancelled lookups are dropped before they touch the disk or wait for the lock
+        if (!m_futureInterface.isCanceled()) {
+            const QMimeType mimeType = lookup();
+            m_futureInterface.reportResult(mimeType);
+        }
+        m_futureInterface.reportFinished();
+    }
+
+private:
+    QMimeType lookup()
+    {
+        int accuracy = 0;
+        if (!m_isFile) {
+            QMimeLookupLocker locker(m_d, QMimeDatabaseCounters::FindByData);
+            return m_d->findByData(m_data, &accuracy);
+        }
+        const QFileInfo fileInfo(m_fileName);
+        QMimeFileAttributes attributes;
+        readFileAttributes(m_d, fileInfo, &attributes);
+        QMimeType result;
+        {
+            QMimeLookupLocker locker(m_d, QMimeDatabaseCounters::FindByNameAndData);
+            result = m_d->findByFile(fileInfo, &accuracy, QMimeLookupOptions(), &attributes);
+        }
+        writeFileAttributes(attributes);
+        return result;
+    }
+
+    QMimeDatabasePrivate *m_d;
+    const bool m_isFile;
+    const QString m_fileName;
+    const QByteArray m_data;
+    QFutureInterface<QMimeType> m_futureInterface;
+};
+
+static QFuture<QMimeType> startLookup(QMimeDatabasePrivate *d, QMimeLookupTask *task)
+{
+    const QFuture<QMimeType> future = task->future();
+    QThreadPool *pool;
+    {
+        QMutexLocker locker(&d->mutex);
+        pool = d->asyncPool();
+    }
+    pool->start(task);
+    return future;
+}
+
+/*!
+    Starts findByFile() for \a fileName in a thread of the database, and
+    returns the future MIME type.
+
+    Use a QFutureWatcher to be notified of the result without blocking the
+    event loop. Cancelling the future drops the lookup if it hasn't started
+    yet; the future then has no result.
+
+    \sa maxAsyncThreadCount()
+*/
+QFuture<QMimeType> QMimeDatabase::findByFileAsync(const QString &fileName) const
+{
+    return startLookup(d, new QMimeLookupTask(d, fileName));
+}
+
+/*!
+    Starts findByUrl() for \a url in a thread of the database, and returns
+    the future MIME type.
+
+    Only local files are read in the thread. The MIME type of other URLs
+    only depends on the name, so the returned future has already finished.
+
+    \sa findByFileAsync()
+*/
+QFuture<QMimeType> QMimeDatabase::findByUrlAsync(const QUrl &url) const
+{
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 0, 0))
+    if (url.isLocalFile())
+        return findByFileAsync(url.toLocalFile());
+#else
+    const QString localFile(url.toLocalFile());
+    if (!localFile.isEmpty())
+        return findByFileAsync(localFile);
+#endif
+
+    QFutureInterface<QMimeType> futureInterface;
+    futureInterface.reportStarted();
+    const QMimeType mimeType = findByUrl(url);
+    futureInterface.reportFinished(&mimeType);
+    return futureInterface.future();
+}
+
+/*!
+    Starts findByData() for \a data in a thread of the database, and returns
+    the future MIME type.
+
+    \sa findByFileAsync()
+*/
+QFuture<QMimeType> QMimeDatabase::findByDataAsync(const QByteArray &data) const
+{
+    return startLookup(d, new QMimeLookupTask(d, data));
+}
+
+/*!
+    Returns the maximum number of threads running the findBy*Async lookups.
+
+    It defaults to QThread::idealThreadCount(), but at most 4. The threads
+    are shared by all the QMimeDatabase instances.
+*/
+int QMimeDatabase::maxAsyncThreadCount() const
+{
+    QMutexLocker locker(&d->mutex);
+
+    return d->asyncPool()->maxThreadCount();
+}
+
+/*!
+    Sets the maximum number of threads running the findBy*Async lookups
+    to \a count. Lookups started beyond that are queued.
+*/
+void QMimeDatabase::setMaxAsyncThreadCount(int count)
+{
+    QMutexLocker locker(&d->mutex);
+
+    d->asyncPool()->setMaxThreadCount(qMax(1, count));
+}
+
+// ------------------------------------------------------------------------------------------------
+
+/*!
+    Returns the list of all available MIME types, sorted by name.
 
     This can be useful for showing all MIME types to the user, for instance
     in a MIME type editor. Do not use unless really necessary in other cases
     though, prefer using the findBy* methods for performance reasons.
+
+    The list is built once and shared between callers; it is rebuilt when
+    the MIME directories change.
+
+    \sa allMimeTypeNames()
 */
 QList<QMimeType> QMimeDatabase::allMimeTypes() const
 {
@@ -611,6 +1548,282 @@ QList<QMimeType> QMimeDatabase::allMimeTypes() const
 
 // ------------------------------------------------------------------------------------------------
 
+/*!
+    Returns the names of all available MIME types, sorted.
+
+    This is cheaper than allMimeTypes() when only walking over the types,
+    since no QMimeType needs to be created. Aliases are not included.
+
+    \sa allMimeTypes()
+*/
+QStringList QMimeDatabase::allMimeTypeNames() const
+{
+    QMutexLocker locker(&d->mutex);
+
+    return d->allMimeTypeNames();
+}
+
+// ------------------------------------------------------------------------------------------------
+
+/*!
+    \class QMimeDatabaseStatistics
+    \brief The QMimeDatabaseStatistics structure describes what the MIME database costs the process.
+
+    The byte counts are estimates of what the data structures hold, not measurements
+    of the heap. They only cover what has been loaded so far: the XML provider reads the
+    magic rules and the comments on first use, for instance.
+
+    \list
+    \o provider: "mime.cache" when the binary cache files are used, "xml" when the
+       XML package files are parsed.
+    \o mimeTypeCount, globPatternCount, magicMatcherCount: the number of types,
+       glob patterns and top-level magic matchers known to the provider.
+    \o mappedBytes: the size of the mime.cache files mapped into memory.
+    \o heapBytes: the memory held by the provider's data structures.
+    \o cacheBytes: the memory held by caches which are built on demand, such as the
+       sorted type list, the comments in other languages and the directory listings.
+    \o loadTime: the time spent loading the data, in milliseconds.
+    \endlist
+
+    \sa QMimeDatabase::statistics()
+*/
+
+QMimeDatabaseStatistics::QMimeDatabaseStatistics()
+    : mimeTypeCount(0), globPatternCount(0), magicMatcherCount(0),
+      mappedBytes(0), heapBytes(0), cacheBytes(0), loadTime(0)
+{
+}
+
+/*!
+    Returns what the database currently costs the process: which provider is used,
+    how much it has loaded, and how much memory and time that took.
+
+    This doesn't load anything which wasn't loaded yet, except for the list of types
+    when using mime.cache.
+*/
+QMimeDatabaseStatistics QMimeDatabase::statistics() const
+{
+    QMutexLocker locker(&d->mutex);
+
+    return d->statistics();
+}
+
+// ------------------------------------------------------------------------------------------------
+
+/*!
+    \class QMimeDatabaseCounters
+    \brief The QMimeDatabaseCounters structure counts what the MIME type lookups did.
+
+    The counters are only updated when enabled with QMimeDatabase::setCountersEnabled(),
+    or by setting the environment variable QT_MIME_COUNTERS, so that the lookups don't pay
+    for them otherwise. They are shared by all the QMimeDatabase instances.
+
+    \list
+    \o calls: the number of findByName(), findByData() and findByNameAndData() calls,
+       findByFile() counting as findByNameAndData().
+    \o latencyHistogram: how long these calls took, including the wait for the lock,
+       in buckets of powers of two microseconds.
+    \o fastGlobHits: the file names matched by the "*.ext" pattern hash of the XML
+       provider, or by the suffix tree of mime.cache.
+    \o magicMatchersEvaluated: the top-level magic matchers tried on some data.
+    \o deviceReads, bytesRead: the reads of file or device contents, and what they returned.
+    \o contentReadsAvoided: the lookups which didn't need to read the contents, because
+       the file name was enough.
+    \o lockWaitTime: the time spent waiting for the database lock, in microseconds.
+    \o nameCacheHits, nameCacheMisses: the file names found in the cache of
+       QMimeDatabase::setNameCacheSize(), or not, while it is enabled.
+    \endlist
+
+    \sa QMimeDatabase::counters()
+*/
+
+QMimeDatabaseCounters::QMimeDatabaseCounters()
+    : fastGlobHits(0), magicMatchersEvaluated(0), deviceReads(0), bytesRead(0),
+      contentReadsAvoided(0), lockWaitTime(0), nameCacheHits(0), nameCacheMisses(0)
+{
+    for (int operation = 0; operation < OperationCount; ++operation) {
+        calls[operation] = 0;
+        for (int bucket = 0; bucket < HistogramBuckets; ++bucket)
+            latencyHistogram[operation][bucket] = 0;
+    }
+}
+
+/*!
+    Returns the counters as text, one "name value" pair per line, for logs and scripts.
+    The histogram buckets are named after their upper bound, e.g. "findByName.latency.lt_4us".
+*/
+QString QMimeDatabaseCounters::toString() const
+{
+    static const char *const operationNames[OperationCount] = {
+        "findByName", "findByData", "findByNameAndData"
+    };
+
+    QString result;
+    QTextStream stream(&result);
+    for (int operation = 0; operation < OperationCount; ++operation) {
+        const char *name = operationNames[operation];
+        stream << name << ".calls " << calls[operation] << '\n';
+        for (int bucket = 0; bucket < HistogramBuckets; ++bucket) {
+            stream << name << ".latency.";
+            if (bucket == HistogramBuckets - 1)
+                stream << "inf ";
+            else
+                stream << "lt_" << (Q_INT64_C(1) << bucket) << "us ";
+            stream << latencyHistogram[operation][bucket] << '\n';
+        }
+    }
+    stream << "fastGlobHits " << fastGlobHits << '\n'
+           << "magicMatchersEvaluated " << magicMatchersEvaluated << '\n'
+           << "deviceReads " << deviceReads << '\n'
+           << "bytesRead " << bytesRead << '\n'
+           << "contentReadsAvoided " << contentReadsAvoided << '\n'
+           << "lockWaitTime " << lockWaitTime << '\n'
+           << "nameCacheHits " << nameCacheHits << '\n'
+           << "nameCacheMisses " << nameCacheMisses << '\n';
+    stream.flush();
+    return result;
+}
+
+/*!
+    Returns true if the lookups update the counters.
+
+    \sa setCountersEnabled()
+*/
+bool QMimeDatabase::countersEnabled() const
+{
+    return d->countersEnabled();
+}
+
+/*!
+    Enables or disables the lookup counters, depending on \a enable.
+    The counters gathered so far are kept.
+
+    \sa counters(), resetCounters()
+*/
+void QMimeDatabase::setCountersEnabled(bool enable)
+{
+    qMimeAtomicStore(d->m_countersEnabled, enable ? 1 : 0);
+}
+
+/*!
+    Returns a snapshot of the lookup counters.
+
+    \sa resetCounters(), QMimeDatabaseCounters::toString()
+*/
+QMimeDatabaseCounters QMimeDatabase::counters() const
+{
+    QMutexLocker locker(&d->mutex);
+
+    return d->m_counters;
+}
+
+/*!
+    Sets all the lookup counters back to zero.
+*/
+void QMimeDatabase::resetCounters()
+{
+    QMutexLocker locker(&d->mutex);
+
+    d->m_counters = QMimeDatabaseCounters();
+}
+
+// ------------------------------------------------------------------------------------------------
+
+/*!
+    \class QMimeLookupTrace
+    \brief The QMimeLookupTrace structure explains how a lookup found its MIME type.
+
+    It lists the stages the lookup went through, in order: for instance the high weight
+    globs, the "*.ext" pattern hash and the low weight globs of the XML provider, or the
+    glob lists and the suffix tree of mime.cache, then the read of the contents, the magic
+    rules and the plain text check. Each stage has the candidates it found with their glob
+    weight or magic priority, how many rules it tried, how many bytes it looked at and how
+    long it took.
+
+    \sa QMimeDatabase::traceFindByFile()
+*/
+
+QMimeLookupTrace::QMimeLookupTrace()
+    : accuracy(0)
+{
+}
+
+QMimeLookupTrace::Stage::Stage()
+    : rulesTried(0), bytesExamined(0), time(0)
+{
+}
+
+/*!
+    Returns the trace as indented text, for instance for mimetypefinder -x.
+*/
+QString QMimeLookupTrace::toString() const
+{
+    QString text;
+    QTextStream stream(&text);
+    stream << lookup << " -> " << result.name() << " (accuracy " << accuracy << ")\n";
+    foreach (const Stage &stage, stages) {
+        stream << "  " << stage.name << ": " << stage.rulesTried << " rules, "
+               << stage.bytesExamined << " bytes, " << stage.time << " ns\n";
+        foreach (const Candidate &candidate, stage.candidates)
+            stream << "    " << candidate.mimeType << " " << candidate.weight << " " << candidate.rule << '\n';
+    }
+    stream.flush();
+    return text;
+}
+
+/*!
+    Returns how findByName() finds the MIME type for \a fileName.
+*/
+QMimeLookupTrace QMimeDatabase::traceFindByName(const QString &fileName) const
+{
+    QMimeLookupTrace trace;
+    trace.lookup = QLatin1String("findByName(") + fileName + QLatin1Char(')');
+
+    QMutexLocker locker(&d->mutex);
+    d->m_trace = &trace;
+    trace.result = d->mimeTypeForFileName(fileName, &trace.accuracy);
+    d->m_trace = 0;
+    return trace;
+}
+
+/*!
+    Returns how findByData() finds the MIME type for \a data.
+*/
+QMimeLookupTrace QMimeDatabase::traceFindByData(const QByteArray &data) const
+{
+    QMimeLookupTrace trace;
+    trace.lookup = QLatin1String("findByData(") + QString::number(data.size()) + QLatin1String(" bytes)");
+
+    QMutexLocker locker(&d->mutex);
+    d->m_trace = &trace;
+    trace.result = d->findByData(data, &trace.accuracy);
+    d->m_trace = 0;
+    return trace;
+}
+
+/*!
+    Returns how findByFile() finds the MIME type for \a fileName.
+*/
+QMimeLookupTrace QMimeDatabase::traceFindByFile(const QString &fileName) const
+{
+    QMimeLookupTrace trace;
+    trace.lookup = QLatin1String("findByFile(") + fileName + QLatin1Char(')');
+
+    const QFileInfo fileInfo(fileName);
+    QMimeFileAttributes attributes;
+    readFileAttributes(d, fileInfo, &attributes);
+    {
+        QMutexLocker locker(&d->mutex);
+        d->m_trace = &trace;
+        trace.result = d->findByFile(fileInfo, &trace.accuracy, QMimeLookupOptions(), &attributes);
+        d->m_trace = 0;
+    }
+    writeFileAttributes(attributes);
+    return trace;
+}
+
+// ------------------------------------------------------------------------------------------------
+
 // TODO: needed?
 #if 0
 QStringList QMimeDatabase::filterStrings() const
@@ -25,6 +25,7 @@
 
 #include "qmimetype.h"
 
+#include <QtCore/QFuture>
 #include <QtCore/QStringList>
 
 QT_BEGIN_NAMESPACE
@@ -34,12 +35,99 @@ class QFileInfo;
 class QIODevice;
 class QUrl;
 
+struct QMIME_EXPORT QMimeDatabaseStatistics
+{
+    QMimeDatabaseStatistics();
+
+    QString provider;
+    int mimeTypeCount;
+    int globPatternCount;
+    int magicMatcherCount;
+    qint64 mappedBytes;
+    qint64 heapBytes;
+    qint64 cacheBytes;
+    qint64 loadTime;
+};
+
+struct QMIME_EXPORT QMimeDatabaseCounters
+{
+    QMimeDatabaseCounters();
+
+    enum Operation {
+        FindByName,
+        FindByData,
+        FindByNameAndData,
+        OperationCount
+    };
+
+    // Bucket 0 counts the calls under 1 microsecond, bucket i > 0 those taking
+    // [2^(i-1), 2^i) microseconds; the last bucket also counts all slower calls.
+    enum { HistogramBuckets = 24 };
+
+    qint64 calls[OperationCount];
+    qint64 latencyHistogram[OperationCount][HistogramBuckets];
+    qint64 fastGlobHits;
+    qint64 magicMatchersEvaluated;
+    qint64 deviceReads;
+    qint64 bytesRead;
+    qint64 contentReadsAvoided;
+    qint64 lockWaitTime;
+    qint64 nameCacheHits;
+    qint64 nameCacheMisses;
+
+    QString toString() const;
+};
+
+struct QMIME_EXPORT QMimeLookupTrace
+{
+    QMimeLookupTrace();
+
+    struct Candidate {
+        QString mimeType;
+        int weight; // the glob weight or the magic priority
+        QString rule; // the glob pattern, or "magic"
+    };
+
+    struct Stage {
+        Stage();
+
+        QString name;
+        QList<Candidate> candidates;
+        int rulesTried;
+        qint64 bytesExamined;
+        qint64 time; // in nanoseconds
+    };
+
+    QString lookup;
+    QList<Stage> stages;
+    QMimeType result;
+    int accuracy;
+
+    QString toString() const;
+};
+
+struct QMIME_EXPORT QMimeLookupOptions
+{
+    QMimeLookupOptions();
+
+    int maxBytesRead;
+    bool readContent;
+    bool followSymlinks;
+    int conclusiveGlobWeight;
+};
+
 struct QMimeDatabasePrivate;
 class QMIME_EXPORT QMimeDatabase
 {
     Q_DISABLE_COPY(QMimeDatabase)
 
 public:
+    enum ExtendedAttributeUsage {
+        IgnoreExtendedAttributes,
+        ReadExtendedAttributes,
+        ReadWriteExtendedAttributes
+    };
+
     QMimeDatabase();
     //explicit QMimeDatabase(QMimeDatabasePrivate *theD);
     ~QMimeDatabase();
@@ -55,9 +143,48 @@ public:
     QMimeType findByNameAndData(const QString &fileName, QIODevice *device) const;
     QMimeType findByNameAndData(const QString &fileName, const QByteArray &data) const;
 
+    QMimeType findByData(QIODevice *device, const QMimeLookupOptions &options) const;
+    QMimeType findByFile(const QString &fileName, const QMimeLookupOptions &options) const;
+    QMimeType findByFile(const QFileInfo &fileInfo, const QMimeLookupOptions &options) const;
+    QMimeType findByUrl(const QUrl &url, const QMimeLookupOptions &options) const;
+    QMimeType findByNameAndData(const QString &fileName, QIODevice *device, const QMimeLookupOptions &options) const;
+
+    QMimeType findByFile(const QString &fileName, int msecs, bool *provisional,
+                         const QMimeLookupOptions &options = QMimeLookupOptions()) const;
+    QMimeType findByNameAndData(const QString &fileName, QIODevice *device, int msecs, bool *provisional,
+                                const QMimeLookupOptions &options = QMimeLookupOptions()) const;
+
+    QStringList retainedLocales() const;
+    void setRetainedLocales(const QStringList &locales);
+
+    int nameCacheSize() const;
+    void setNameCacheSize(int size);
+
+    ExtendedAttributeUsage extendedAttributeUsage() const;
+    void setExtendedAttributeUsage(ExtendedAttributeUsage usage);
+
+    QFuture<QMimeType> findByFileAsync(const QString &fileName) const;
+    QFuture<QMimeType> findByUrlAsync(const QUrl &url) const;
+    QFuture<QMimeType> findByDataAsync(const QByteArray &data) const;
+
+    int maxAsyncThreadCount() const;
+    void setMaxAsyncThreadCount(int count);
+
     QString suffixForFileName(const QString &fileName) const;
 
     QList<QMimeType> allMimeTypes() const;
+    QStringList allMimeTypeNames() const;
+
+    QMimeDatabaseStatistics statistics() const;
+
+    bool countersEnabled() const;
+    void setCountersEnabled(bool enable);
+    QMimeDatabaseCounters counters() const;
+    void resetCounters();
+
+    QMimeLookupTrace traceFindByName(const QString &fileName) const;
+    QMimeLookupTrace traceFindByData(const QByteArray &data) const;
+    QMimeLookupTrace traceFindByFile(const QString &fileName) const;
 
 #if 0
     // This must be a huge list, why would anyone ever want this?
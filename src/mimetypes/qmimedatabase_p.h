@@ -21,21 +21,110 @@
 #ifndef QMIMEDATABASE_P_H_INCLUDED
 #define QMIMEDATABASE_P_H_INCLUDED
 
+#include <QtCore/QAtomicInt>
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QMultiHash>
 #include <QtCore/QMutex>
+#include <QtCore/QSet>
 
+#include "qmimedatabase.h"
 #include "qmimetype.h"
 #include "qmimetype_p.h"
 #include "qmimeglobpattern_p.h"
+#include "qmimedirectorycache_p.h"
+#include "qmimenamecache_p.h"
 
 // ------------------------------------------------------------------------------------------------
 
 QT_BEGIN_NAMESPACE
 
+class QFile;
 class QMimeDatabase;
 class QMimeProviderBase;
+class QThreadPool;
 
-struct QMimeDatabasePrivate
+// Records one stage of the lookup traced by the database, if any
+class QMimeTraceStage
+{
+public:
+    QMimeTraceStage(QMimeLookupTrace *trace, const char *name);
+    ~QMimeTraceStage();
+
+    bool isActive() const { return m_trace != 0; }
+    void addCandidate(const QString &mimeType, int weight, const QString &rule);
+    void addRulesTried(int count) { m_stage.rulesTried += count; }
+    void addBytesExamined(qint64 count) { m_stage.bytesExamined += count; }
+
+private:
+    Q_DISABLE_COPY(QMimeTraceStage)
+
+    QMimeLookupTrace *m_trace;
+    QMimeLookupTrace::Stage m_stage;
+    QElapsedTimer m_timer;
+};
+
+// The time left to a lookup started with a deadline. The stages that are
+// skipped once it has expired make the result provisional.
+class QMimeLookupDeadline
+{
+public:
+    explicit QMimeLookupDeadline(int msecs)
+        : m_msecs(msecs), m_expired(false)
+    { m_timer.start(); }
+
+    bool hasExpired()
+    {
+        if (!m_expired && m_msecs >= 0 && m_timer.hasExpired(m_msecs))
+            m_expired = true;
+        return m_expired;
+    }
+    // -1 when there is no limit
+    int remainingTime() const
+    { return m_msecs < 0 ? -1 : int(qMax(Q_INT64_C(0), m_msecs - m_timer.elapsed())); }
+    bool isProvisional() const { return m_expired; }
+
+private:
+    Q_DISABLE_COPY(QMimeLookupDeadline)
+
+    const qint64 m_msecs;
+    bool m_expired;
+    QElapsedTimer m_timer;
+};
+
+// QAtomicInt::load() and store() were only added in Qt 5
+inline int qMimeAtomicLoad(const QAtomicInt &value)
+{
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 0, 0))
+    return value.load();
+#else
+    return value;
+#endif
+}
+
+inline void qMimeAtomicStore(QAtomicInt &value, int newValue)
+{
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 0, 0))
+    value.store(newValue);
+#else
+    value = newValue;
+#endif
+}
+
+// The extended attributes of a file, read before a findByFile() lookup and
+// written after it, while the database isn't locked
+struct QMimeFileAttributes
+{
+    QMimeFileAttributes() : read(false) {}
+
+    bool read;                 // false when the attributes aren't used
+    QByteArray nativeFilePath;
+    QByteArray stamp;          // the current modification time and size of the file
+    QByteArray recordedName;   // user.mime_type
+    QByteArray recordedStamp;  // user.mime_type_stamp, empty for a type set by the user
+    QByteArray detectedName;   // the type to record after the lookup, if any
+};
+
+struct QMIME_EXPORT QMimeDatabasePrivate
 {
     Q_DISABLE_COPY(QMimeDatabasePrivate)
 
@@ -49,22 +138,69 @@ struct QMimeDatabasePrivate
 
     QString defaultMimeType() const { return m_defaultMimeType; }
 
+    // These only lock m_retainedLocalesMutex, so they can be called with or without the database locked
+    QStringList retainedLocales() const;
+    void setRetainedLocales(const QStringList &locales);
+    bool isRetainedLocale(const QString &locale) const;
+    QSet<QString> retainedLocaleSet() const;
+
 #if 0
     QStringList filterStrings() const;
 #endif
 
     bool inherits(const QString &mime, const QString &parent);
+    const QHash<QString, QStringList> &children();
+    QSet<QString> magicCandidates(const QStringList &candidatesByName);
+
+    QByteArray fingerprint();
 
     QList<QMimeType> allMimeTypes();
+    QStringList allMimeTypeNames();
+    QMimeDatabaseStatistics statistics();
 
+    // The counters are only updated while the database is locked, but whether
+    // they are enabled is also read before locking it
+    bool countersEnabled() const { return qMimeAtomicLoad(m_countersEnabled) != 0; }
+    void recordCall(QMimeDatabaseCounters::Operation operation, qint64 usecs);
+
+    // Read without the database locked, see QMimeFileAttributes
+    QMimeDatabase::ExtendedAttributeUsage extendedAttributeUsage() const
+    { return QMimeDatabase::ExtendedAttributeUsage(qMimeAtomicLoad(m_extendedAttributeUsage)); }
 
     QMimeType mimeTypeForName(const QString &nameOrAlias);
-    QMimeType findByNameAndData(const QString &fileName, QIODevice *device, int *priorityPtr);
+    QMimeType mimeTypeForFileName(const QString &fileName, int *accuracyPtr);
+    // The extended attributes are only used when read by the caller into attributes
+    QMimeType findByFile(const QFileInfo &fileInfo, int *accuracyPtr,
+                         const QMimeLookupOptions &options = QMimeLookupOptions(),
+                         QMimeFileAttributes *attributes = 0);
+    QMimeType findByFileWithAttributes(const QString &fileName, QFile *file, int *accuracyPtr,
+                                       const QMimeLookupOptions &options, QMimeFileAttributes *attributes);
+    QMimeType findByNameAndData(const QString &fileName, QIODevice *device, int *priorityPtr,
+                                const QMimeLookupOptions &options = QMimeLookupOptions());
+    int contentsSize(int maxSize);
+    QByteArray peekContents(QIODevice *device, int maxSize);
     QMimeType findByData(const QByteArray &data, int *priorityPtr);
-    QStringList findByName(const QString &fileName, QString *foundSuffix = 0);
+    QStringList findByName(const QString &fileName, QString *foundSuffix = 0, int *weightPtr = 0);
+
+    // Runs the findBy*Async lookups, created on first use
+    QThreadPool *asyncPool();
 
     mutable QMimeProviderBase *m_provider;
     const QString m_defaultMimeType;
+    QMimeDirectoryCache m_directoryCache;
+    QMimeNameCache m_nameCache;
+    // Parent -> children, built on first use and again when the directories change
+    QHash<QString, QStringList> m_children;
+    bool m_childrenLoaded;
+    int m_childrenGeneration;
+    QSet<QString> m_retainedLocales; // empty: all of them
+    mutable QMutex m_retainedLocalesMutex;
+    QAtomicInt m_countersEnabled;
+    QMimeDatabaseCounters m_counters;
+    QMimeLookupTrace *m_trace; // the lookup being traced, if any
+    QMimeLookupDeadline *m_deadline; // the deadline of the current lookup, if any
+    QAtomicInt m_extendedAttributeUsage;
+    QThreadPool *m_asyncPool;
     QMutex mutex;
 };
 
@@ -0,0 +1,251 @@
+/**************************************************************************
+**
+** This file is part of QMime
+**
+** Based on Qt Creator source code
+**
+** Qt Creator Copyright (c) 2011 Nokia Corporation and/or its subsidiary(-ies).
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+**************************************************************************/
+
+#include "qmimedirectorycache_p.h"
+
+#include <qstandardpaths.h>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QFileSystemWatcher>
+
+QT_BEGIN_NAMESPACE
+
+/*!
+    \internal
+    \class QMimeDirectoryCache
+    \brief The QMimeDirectoryCache class caches the location and contents of the "mime" data directories.
+
+    QStandardPaths::locateAll() re-reads the XDG environment variables and stats
+    every candidate path on each call. The providers call it for every per-type
+    lookup (comments, glob patterns) and for allMimeTypes(), so the result of
+    the first lookup in each directory is kept until invalidate() is called.
+
+    When watching is enabled (the default), the directories which were listed are
+    monitored with a QFileSystemWatcher and the cache invalidates itself when
+    one of them changes, for instance after update-mime-database ran.
+    This requires an event loop in the application's main thread; without one,
+    invalidate() has to be called explicitly.
+
+    \sa QStandardPaths
+*/
+
+QMimeDirectoryCache::QMimeDirectoryCache(QObject *parent)
+    : QObject(parent),
+      m_resolved(false),
+      m_watchingEnabled(true),
+      m_watchScheduled(false),
+      m_generation(0),
+      m_watcher(0)
+{
+    // The watcher has to live in a thread with an event loop.
+    QCoreApplication *app = QCoreApplication::instance();
+    if (app && !parent)
+        moveToThread(app->thread());
+}
+
+QMimeDirectoryCache::~QMimeDirectoryCache()
+{
+}
+
+/*!
+    Returns the existing "mime" directories, in the order of QStandardPaths::standardLocations().
+ */
+QStringList QMimeDirectoryCache::mimeDirectories()
+{
+    QMutexLocker locker(&m_mutex);
+    ensureResolved();
+    return m_mimeDirs;
+}
+
+/*!
+    Equivalent to QStandardPaths::locateAll(QStandardPaths::GenericDataLocation,
+    "mime/" + \a fileName), without touching the filesystem once the directories
+    involved have been listed.
+ */
+QStringList QMimeDirectoryCache::locateAll(const QString &fileName)
+{
+    QMutexLocker locker(&m_mutex);
+    ensureResolved();
+
+    const int slash = fileName.lastIndexOf(QLatin1Char('/'));
+    const QString subDir = slash == -1 ? QString() : fileName.left(slash);
+    const QString name = fileName.mid(slash + 1);
+    const bool simpleSubDir = !subDir.isEmpty() && !subDir.contains(QLatin1Char('/'));
+
+    QStringList result;
+    foreach (const QString &mimeDir, m_mimeDirs) {
+        if (simpleSubDir && !entries(mimeDir).dirs.contains(subDir))
+            continue;
+        const QString dirPath = subDir.isEmpty() ? mimeDir : mimeDir + QLatin1Char('/') + subDir;
+        if (entries(dirPath).files.contains(name))
+            result.append(dirPath + QLatin1Char('/') + name);
+    }
+    return result;
+}
+
+/*!
+    Equivalent to QStandardPaths::locateAll(QStandardPaths::GenericDataLocation,
+    "mime/" + \a dirName, QStandardPaths::LocateDirectory).
+ */
+QStringList QMimeDirectoryCache::locateAllDirectories(const QString &dirName)
+{
+    QMutexLocker locker(&m_mutex);
+    ensureResolved();
+
+    const int slash = dirName.lastIndexOf(QLatin1Char('/'));
+    const QString parentDir = slash == -1 ? QString() : dirName.left(slash);
+    const QString name = dirName.mid(slash + 1);
+
+    QStringList result;
+    foreach (const QString &mimeDir, m_mimeDirs) {
+        const QString dirPath = parentDir.isEmpty() ? mimeDir : mimeDir + QLatin1Char('/') + parentDir;
+        if (entries(dirPath).dirs.contains(name))
+            result.append(dirPath + QLatin1Char('/') + name);
+    }
+    return result;
+}
+
+/*!
+    Returns a number which changes every time the cache is invalidated.
+    Users holding data derived from the directory contents compare it
+    to decide when to reload.
+ */
+int QMimeDirectoryCache::generation()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_generation;
+}
+
+static qint64 stringSetSize(const QSet<QString> &strings)
+{
+    qint64 size = 0;
+    foreach (const QString &str, strings)
+        size += sizeof(QString) + 2 * sizeof(void *) + (str.size() + 1) * sizeof(QChar);
+    return size;
+}
+
+/*!
+    Returns an estimate of the memory used by the directory listings, in bytes.
+ */
+qint64 QMimeDirectoryCache::memoryUsage()
+{
+    QMutexLocker locker(&m_mutex);
+    qint64 size = 0;
+    QHash<QString, Entries>::const_iterator it = m_entries.constBegin();
+    for ( ; it != m_entries.constEnd(); ++it) {
+        size += sizeof(Entries) + (it.key().size() + 1) * sizeof(QChar);
+        size += stringSetSize(it.value().files) + stringSetSize(it.value().dirs);
+    }
+    return size;
+}
+
+void QMimeDirectoryCache::setWatchingEnabled(bool enable)
+{
+    QMutexLocker locker(&m_mutex);
+    m_watchingEnabled = enable;
+}
+
+bool QMimeDirectoryCache::isWatchingEnabled()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_watchingEnabled;
+}
+
+/*!
+    Forgets everything, the next lookup will resolve the directories again.
+    This also picks up changes to XDG_DATA_HOME and XDG_DATA_DIRS.
+ */
+void QMimeDirectoryCache::invalidate()
+{
+    QMutexLocker locker(&m_mutex);
+    m_resolved = false;
+    m_mimeDirs.clear();
+    m_entries.clear();
+    ++m_generation;
+}
+
+void QMimeDirectoryCache::directoryChanged(const QString &path)
+{
+    Q_UNUSED(path);
+    invalidate();
+}
+
+void QMimeDirectoryCache::addPendingWatches()
+{
+    QMutexLocker locker(&m_mutex);
+    m_watchScheduled = false;
+    if (!m_watchingEnabled || m_pendingWatches.isEmpty())
+        return;
+    if (!m_watcher) {
+        m_watcher = new QFileSystemWatcher(this);
+        connect(m_watcher, SIGNAL(directoryChanged(QString)), this, SLOT(directoryChanged(QString)));
+    }
+    m_watcher->addPaths(m_pendingWatches);
+    m_pendingWatches.clear();
+}
+
+// Must be called with m_mutex locked.
+void QMimeDirectoryCache::ensureResolved()
+{
+    if (m_resolved)
+        return;
+    m_mimeDirs = QStandardPaths::locateAll(QStandardPaths::GenericDataLocation, QLatin1String("mime"), QStandardPaths::LocateDirectory);
+    m_resolved = true;
+}
+
+// Must be called with m_mutex locked.
+const QMimeDirectoryCache::Entries &QMimeDirectoryCache::entries(const QString &dirPath)
+{
+    QHash<QString, Entries>::const_iterator it = m_entries.constFind(dirPath);
+    if (it != m_entries.constEnd())
+        return *it;
+
+    Entries &dirEntries = m_entries[dirPath];
+    const QDir dir(dirPath);
+    if (dir.exists()) {
+        const QFileInfoList infos = dir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden);
+        foreach (const QFileInfo &info, infos) {
+            if (info.isDir())
+                dirEntries.dirs.insert(info.fileName());
+            else if (info.isFile())
+                dirEntries.files.insert(info.fileName());
+        }
+        watch(dirPath);
+    }
+    return dirEntries;
+}
+
+// Must be called with m_mutex locked.
+void QMimeDirectoryCache::watch(const QString &dirPath)
+{
+    if (!m_watchingEnabled || m_watchedDirs.contains(dirPath))
+        return;
+    m_watchedDirs.insert(dirPath);
+    m_pendingWatches.append(dirPath);
+    // QFileSystemWatcher isn't thread-safe, so only touch it from our own thread.
+    if (!m_watchScheduled) {
+        m_watchScheduled = true;
+        QMetaObject::invokeMethod(this, "addPendingWatches", Qt::QueuedConnection);
+    }
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,91 @@
+/**************************************************************************
+**
+** This file is part of QMime
+**
+** Based on Qt Creator source code
+**
+** Qt Creator Copyright (c) 2011 Nokia Corporation and/or its subsidiary(-ies).
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+**************************************************************************/
+
+#ifndef QMIMEDIRECTORYCACHE_P_H
+#define QMIMEDIRECTORYCACHE_P_H
+
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
+
+#include "qmime_global.h"
+
+QT_BEGIN_NAMESPACE
+
+class QFileSystemWatcher;
+
+/*
+   Remembers where the "mime" directories are (one per XDG data dir),
+   and what they contain, so that looking up mime/types, mime/mime.cache
+   or mime/<media>/<subtype>.xml doesn't hit the filesystem every time.
+ */
+class QMIME_EXPORT QMimeDirectoryCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit QMimeDirectoryCache(QObject *parent = 0);
+    ~QMimeDirectoryCache();
+
+    QStringList mimeDirectories();
+    QStringList locateAll(const QString &fileName);
+    QStringList locateAllDirectories(const QString &dirName);
+
+    int generation();
+    qint64 memoryUsage();
+
+    void setWatchingEnabled(bool enable);
+    bool isWatchingEnabled();
+
+public Q_SLOTS:
+    void invalidate();
+
+private Q_SLOTS:
+    void directoryChanged(const QString &path);
+    void addPendingWatches();
+
+private:
+    struct Entries
+    {
+        QSet<QString> files;
+        QSet<QString> dirs;
+    };
+
+    void ensureResolved();
+    const Entries &entries(const QString &dirPath);
+    void watch(const QString &dirPath);
+
+    QMutex m_mutex;
+    bool m_resolved;
+    bool m_watchingEnabled;
+    bool m_watchScheduled;
+    int m_generation;
+    QStringList m_mimeDirs;
+    QHash<QString, Entries> m_entries; // absolute directory path -> its contents
+    QFileSystemWatcher *m_watcher;
+    QSet<QString> m_watchedDirs;
+    QStringList m_pendingWatches;
+};
+
+QT_END_NAMESPACE
+
+#endif // QMIMEDIRECTORYCACHE_P_H
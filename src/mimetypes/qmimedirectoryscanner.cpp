@@ -0,0 +1,356 @@
+/****************************************************************************
+**
+** This file is part of QMime
+**
+** Based on Qt Creator source code
+**
+** Qt Creator Copyright (c) 2011 Nokia Corporation and/or its subsidiary(-ies).
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "qmimedirectoryscanner_p.h"
+
+#include "qmimecontentreader_p.h"
+#include "qmimedatabase_p.h"
+#include "qmimefileindex_p.h"
+
+#include <QtCore/QBuffer>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QRunnable>
+#include <qplatformdefs.h>
+
+#ifdef Q_OS_UNIX
+#include <dirent.h>
+#endif
+
+QT_BEGIN_NAMESPACE
+
+// The files of a directory are classified in batches of this size, so that
+// the threads share the work of large directories
+enum { ClassifyBatchSize = 256 };
+
+namespace {
+
+class DirectoryTask : public QRunnable
+{
+public:
+    DirectoryTask(QMimeDirectoryScannerPrivate *d, const QString &dirPath)
+        : m_d(d), m_dirPath(dirPath) {}
+
+    void run() { m_d->scanDirectory(m_dirPath); }
+
+private:
+    QMimeDirectoryScannerPrivate *m_d;
+    const QString m_dirPath;
+};
+
+class ClassifyTask : public QRunnable
+{
+public:
+    ClassifyTask(QMimeDirectoryScannerPrivate *d, const QStringList &filePaths)
+        : m_d(d), m_filePaths(filePaths) {}
+
+    void run() { m_d->classifyFiles(m_filePaths); }
+
+private:
+    QMimeDirectoryScannerPrivate *m_d;
+    const QStringList m_filePaths;
+};
+
+} // namespace
+
+QMimeDirectoryScannerPrivate::QMimeDirectoryScannerPrivate(QMimeDirectoryScanner *qq)
+    : q(qq), m_db(QMimeDatabasePrivate::instance()), m_index(0)
+{
+}
+
+void QMimeDirectoryScannerPrivate::scanDirectory(const QString &dirPath)
+{
+    QStringList batch;
+
+#if defined(Q_OS_UNIX) && defined(DT_UNKNOWN)
+    // readdir tells the type of most entries, so only the symbolic links and
+    // the entries of filesystems which don't fill d_type need a stat
+    const QString prefix = dirPath.endsWith(QLatin1Char('/')) ? dirPath : dirPath + QLatin1Char('/');
+    DIR *dir = ::opendir(QFile::encodeName(dirPath).constData());
+    if (!dir)
+        return;
+    while (struct dirent *entry = ::readdir(dir)) {
+        const char *name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+            continue;
+        const QString filePath = prefix + QFile::decodeName(name);
+
+        int type = entry->d_type;
+        if (type == DT_UNKNOWN) {
+            QT_STATBUF statBuffer;
+            if (QT_LSTAT(QFile::encodeName(filePath).constData(), &statBuffer) != 0)
+                continue;
+            type = S_ISDIR(statBuffer.st_mode) ? DT_DIR
+                 : S_ISLNK(statBuffer.st_mode) ? DT_LNK
+                 : S_ISCHR(statBuffer.st_mode) ? DT_CHR
+                 : S_ISBLK(statBuffer.st_mode) ? DT_BLK
+                 : S_ISFIFO(statBuffer.st_mode) ? DT_FIFO
+                 : S_ISSOCK(statBuffer.st_mode) ? DT_SOCK
+                 : DT_REG;
+        }
+
+        switch (type) {
+        case DT_DIR:
+            m_pool.start(new DirectoryTask(this, filePath));
+            continue;
+        case DT_LNK:
+            // Like findByFile: links are followed, but links to directories aren't scanned
+            if (QFileInfo(filePath).isDir()) {
+                report(filePath, mimeTypeForName(QLatin1String("inode/directory")));
+                continue;
+            }
+            break;
+        case DT_CHR:
+            report(filePath, mimeTypeForName(QLatin1String("inode/chardevice")));
+            continue;
+        case DT_BLK:
+            report(filePath, mimeTypeForName(QLatin1String("inode/blockdevice")));
+            continue;
+        case DT_FIFO:
+            report(filePath, mimeTypeForName(QLatin1String("inode/fifo")));
+            continue;
+        case DT_SOCK:
+            report(filePath, mimeTypeForName(QLatin1String("inode/socket")));
+            continue;
+        default:
+            break;
+        }
+
+        batch.append(filePath);
+        if (batch.count() == ClassifyBatchSize) {
+            m_pool.start(new ClassifyTask(this, batch));
+            batch.clear();
+        }
+    }
+    ::closedir(dir);
+#else
+    QDirIterator it(dirPath, QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+    while (it.hasNext()) {
+        const QString filePath = it.next();
+        const QFileInfo fileInfo = it.fileInfo();
+        if (fileInfo.isDir()) {
+            if (fileInfo.isSymLink())
+                report(filePath, mimeTypeForName(QLatin1String("inode/directory")));
+            else
+                m_pool.start(new DirectoryTask(this, filePath));
+            continue;
+        }
+        batch.append(filePath);
+        if (batch.count() == ClassifyBatchSize) {
+            m_pool.start(new ClassifyTask(this, batch));
+            batch.clear();
+        }
+    }
+#endif
+
+    // The last files are classified by this thread rather than by a new task
+    classifyFiles(batch);
+}
+
+// The same as findByFile for regular files, but the files are only read when their
+// name isn't conclusive, all together, and without holding the database lock.
+// With an index, the files which didn't change since it was saved aren't classified.
+void QMimeDirectoryScannerPrivate::classifyFiles(const QStringList &filePaths)
+{
+    QStringList unindexed;
+    QVector<QMimeFileIndexEntry> identities; // of the unindexed files, if any
+    if (m_index) {
+        foreach (const QString &filePath, filePaths) {
+            QMimeFileIndexEntry identity = QMimeFileIndexEntry(); // inode 0: not indexed
+            if (QMimeFileIndexPrivate::identify(filePath, &identity)) {
+                const QString mimeTypeName = m_index->d->loadedMimeTypeName(identity);
+                if (!mimeTypeName.isEmpty()) {
+                    const QMimeType mime = mimeTypeForName(mimeTypeName);
+                    if (mime.isValid()) {
+                        m_index->d->record(identity, mimeTypeName, true);
+                        report(filePath, mime);
+                        continue;
+                    }
+                }
+            }
+            unindexed.append(filePath);
+            identities.append(identity);
+        }
+    } else {
+        unindexed = filePaths;
+    }
+
+    QStringList undecided;
+    QVector<const QMimeFileIndexEntry *> undecidedIdentities;
+    const QList<QMimeType> mimeTypesByName = classifyByName(unindexed);
+    for (int i = 0; i < unindexed.count(); ++i) {
+        const QString &filePath = unindexed.at(i);
+        const QMimeFileIndexEntry *identity = identities.isEmpty() ? 0 : &identities.at(i);
+        const QMimeType &mime = mimeTypesByName.at(i);
+        if (mime.isValid()) {
+            report(filePath, identity, mime);
+        } else {
+            undecided.append(filePath);
+            undecidedIdentities.append(identity);
+        }
+    }
+    if (undecided.isEmpty())
+        return;
+
+    int prefixSize;
+    {
+        QMutexLocker locker(&m_db->mutex);
+        prefixSize = m_db->contentsSize(QMimeContentReader::PrefixSize);
+    }
+    QList<QByteArray> contents;
+    QVector<bool> opened;
+    QMimeContentReader::readPrefixes(undecided, prefixSize, &contents, &opened);
+    for (int i = 0; i < undecided.count(); ++i) {
+        const QMimeType mime = classifyByContents(undecided.at(i), opened.at(i) ? &contents[i] : 0);
+        report(undecided.at(i), undecidedIdentities.at(i), mime);
+    }
+}
+
+// Also records the type in the index, if any and if the file has an identity
+void QMimeDirectoryScannerPrivate::report(const QString &filePath, const QMimeFileIndexEntry *identity,
+                                          const QMimeType &mimeType)
+{
+    if (identity && identity->inode != 0)
+        m_index->d->record(*identity, mimeType.name());
+    report(filePath, mimeType);
+}
+
+QMimeType QMimeDirectoryScannerPrivate::mimeTypeForName(const QString &name)
+{
+    QMutexLocker locker(&m_db->mutex);
+    return m_db->mimeTypeForName(name);
+}
+
+// For each file, returns the type when its name matches exactly one, an invalid
+// type otherwise. The whole batch is looked up with the database locked once.
+QList<QMimeType> QMimeDirectoryScannerPrivate::classifyByName(const QStringList &filePaths)
+{
+    QList<QMimeType> mimeTypes;
+    mimeTypes.reserve(filePaths.count());
+    QMutexLocker locker(&m_db->mutex);
+    foreach (const QString &filePath, filePaths) {
+        const QStringList candidates = m_db->findByName(filePath);
+        mimeTypes.append(candidates.count() == 1 ? m_db->mimeTypeForName(candidates.first()) : QMimeType());
+    }
+    return mimeTypes;
+}
+
+// Finds the type from the name and the first bytes of the file, or from the name
+// only if the file couldn't be opened (\a contents is 0)
+QMimeType QMimeDirectoryScannerPrivate::classifyByContents(const QString &filePath, QByteArray *contents)
+{
+    int accuracy = 0;
+    if (!contents) {
+        QMutexLocker locker(&m_db->mutex);
+        return m_db->mimeTypeForFileName(filePath, &accuracy);
+    }
+    QBuffer buffer(contents);
+    QMutexLocker locker(&m_db->mutex);
+    return m_db->findByNameAndData(filePath, &buffer, &accuracy);
+}
+
+/*!
+    \class QMimeDirectoryScanner
+    \brief The QMimeDirectoryScanner class finds the MIME types of all the files in a directory tree.
+
+    This is faster than calling QMimeDatabase::findByFile() on each file of a large tree:
+    on Unix the directories are listed with readdir, which tells the type of the entries
+    without a stat, the files are only opened when their name doesn't tell their MIME
+    type, and the directories and files are shared between several threads.
+
+    Subclasses receive the results in classified().
+
+    \sa QMimeDatabase
+*/
+
+/*!
+    Creates a scanner using QThread::idealThreadCount() threads.
+*/
+QMimeDirectoryScanner::QMimeDirectoryScanner()
+    : d(new QMimeDirectoryScannerPrivate(this))
+{
+}
+
+QMimeDirectoryScanner::~QMimeDirectoryScanner()
+{
+    delete d;
+}
+
+/*!
+    Returns the maximum number of threads used to scan.
+*/
+int QMimeDirectoryScanner::maxThreadCount() const
+{
+    return d->m_pool.maxThreadCount();
+}
+
+/*!
+    Sets the maximum number of threads used to scan to \a count.
+*/
+void QMimeDirectoryScanner::setMaxThreadCount(int count)
+{
+    d->m_pool.setMaxThreadCount(count);
+}
+
+/*!
+    Returns the index used to skip the files which didn't change, 0 by default.
+*/
+QMimeFileIndex *QMimeDirectoryScanner::index() const
+{
+    return d->m_index;
+}
+
+/*!
+    Sets the \a index used to skip the files which didn't change since it was
+    saved. The files classified by scan() are recorded in it, so that saving it
+    afterwards lets the next scan skip them.
+
+    The scanner doesn't take ownership of the index.
+
+    \sa QMimeFileIndex::save()
+*/
+void QMimeDirectoryScanner::setIndex(QMimeFileIndex *index)
+{
+    d->m_index = index;
+}
+
+/*!
+    Finds the MIME types of the files in \a directoryPath and its subdirectories,
+    calling classified() for each of them, and returns when all were classified.
+
+    The directories themselves aren't reported, except for symbolic links to
+    directories, which aren't followed.
+*/
+void QMimeDirectoryScanner::scan(const QString &directoryPath)
+{
+    d->m_pool.start(new DirectoryTask(d, directoryPath));
+    d->m_pool.waitForDone();
+}
+
+/*!
+    \fn void QMimeDirectoryScanner::classified(const QString &filePath, const QMimeType &mimeType)
+
+    Called with the MIME type of each file found by scan(), in no particular order.
+    This is called from the scanning threads, possibly by several of them at the
+    same time.
+*/
+
+QT_END_NAMESPACE
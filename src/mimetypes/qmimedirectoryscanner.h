@@ -0,0 +1,58 @@
+/****************************************************************************
+**
+** This file is part of QMime
+**
+** Based on Qt Creator source code
+**
+** Qt Creator Copyright (c) 2011 Nokia Corporation and/or its subsidiary(-ies).
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QMIMEDIRECTORYSCANNER_H_INCLUDED
+#define QMIMEDIRECTORYSCANNER_H_INCLUDED
+
+#include "qmime_global.h"
+
+#include "qmimetype.h"
+
+QT_BEGIN_NAMESPACE
+
+class QMimeFileIndex;
+class QMimeDirectoryScannerPrivate;
+class QMIME_EXPORT QMimeDirectoryScanner
+{
+    Q_DISABLE_COPY(QMimeDirectoryScanner)
+
+public:
+    QMimeDirectoryScanner();
+    virtual ~QMimeDirectoryScanner();
+
+    int maxThreadCount() const;
+    void setMaxThreadCount(int count);
+
+    QMimeFileIndex *index() const;
+    void setIndex(QMimeFileIndex *index);
+
+    void scan(const QString &directoryPath);
+
+protected:
+    virtual void classified(const QString &filePath, const QMimeType &mimeType) = 0;
+
+private:
+    friend class QMimeDirectoryScannerPrivate;
+    QMimeDirectoryScannerPrivate *d;
+};
+
+QT_END_NAMESPACE
+
+#endif   // QMIMEDIRECTORYSCANNER_H_INCLUDED
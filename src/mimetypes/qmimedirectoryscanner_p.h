@@ -0,0 +1,58 @@
+/****************************************************************************
+**
+** This file is part of QMime
+**
+** Based on Qt Creator source code
+**
+** Qt Creator Copyright (c) 2011 Nokia Corporation and/or its subsidiary(-ies).
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QMIMEDIRECTORYSCANNER_P_H_INCLUDED
+#define QMIMEDIRECTORYSCANNER_P_H_INCLUDED
+
+#include "qmimedirectoryscanner.h"
+
+#include <QtCore/QStringList>
+#include <QtCore/QThreadPool>
+
+QT_BEGIN_NAMESPACE
+
+struct QMimeDatabasePrivate;
+struct QMimeFileIndexEntry;
+
+class QMimeDirectoryScannerPrivate
+{
+public:
+    explicit QMimeDirectoryScannerPrivate(QMimeDirectoryScanner *qq);
+
+    // Both are run by the threads of the pool
+    void scanDirectory(const QString &dirPath);
+    void classifyFiles(const QStringList &filePaths);
+
+    QList<QMimeType> classifyByName(const QStringList &filePaths);
+    QMimeType classifyByContents(const QString &filePath, QByteArray *contents);
+    QMimeType mimeTypeForName(const QString &name);
+    void report(const QString &filePath, const QMimeType &mimeType)
+    { q->classified(filePath, mimeType); }
+    void report(const QString &filePath, const QMimeFileIndexEntry *identity, const QMimeType &mimeType);
+
+    QMimeDirectoryScanner *q;
+    QMimeDatabasePrivate *m_db;
+    QMimeFileIndex *m_index;
+    QThreadPool m_pool;
+};
+
+QT_END_NAMESPACE
+
+#endif   // QMIMEDIRECTORYSCANNER_P_H_INCLUDED
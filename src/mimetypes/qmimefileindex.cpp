@@ -0,0 +1,338 @@
+/****************************************************************************
+**
+** This file is part of QMime
+**
+** Based on Qt Creator source code
+**
+** Qt Creator Copyright (c) 2011 Nokia Corporation and/or its subsidiary(-ies).
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "qmimefileindex_p.h"
+
+#include "qmimedatabase.h"
+#include "qmimedatabase_p.h"
+
+#include <qplatformdefs.h>
+
+#include <algorithm>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+QT_BEGIN_NAMESPACE
+
+static const char indexMagic[8] = { 'Q', 'M', 'I', 'M', 'E', 'I', 'D', 'X' };
+enum { IndexVersion = 2, IndexByteOrder = 0x01020304 };
+
+static bool lessIdentity(const QMimeFileIndexEntry &e1, const QMimeFileIndexEntry &e2)
+{
+    return e1.device < e2.device || (e1.device == e2.device && e1.inode < e2.inode);
+}
+
+static bool sameIdentity(const QMimeFileIndexEntry &e1, const QMimeFileIndexEntry &e2)
+{
+    return e1.device == e2.device && e1.inode == e2.inode;
+}
+
+QMimeFileIndexPrivate::QMimeFileIndexPrivate()
+    : m_map(0), m_loadedEntries(0), m_loadedCount(0), m_reusedCount(0)
+{
+}
+
+void QMimeFileIndexPrivate::unload()
+{
+    if (m_map)
+        m_file.unmap(m_map);
+    m_file.close();
+    m_map = 0;
+    m_loadedEntries = 0;
+    m_loadedCount = 0;
+    m_loadedTypeNames.clear();
+    m_entries.clear();
+    m_typeNames.clear();
+    m_typeIds.clear();
+    m_reusedCount = 0;
+}
+
+bool QMimeFileIndexPrivate::identify(const QString &filePath, QMimeFileIndexEntry *entry)
+{
+#ifdef Q_OS_UNIX
+    QT_STATBUF statBuffer;
+    if (QT_STAT(QFile::encodeName(filePath).constData(), &statBuffer) != 0 || !S_ISREG(statBuffer.st_mode))
+        return false;
+    entry->device = statBuffer.st_dev;
+    entry->inode = statBuffer.st_ino;
+#ifdef Q_OS_MAC
+    entry->mtime = qint64(statBuffer.st_mtimespec.tv_sec) * 1000000000 + statBuffer.st_mtimespec.tv_nsec;
+#else
+    entry->mtime = qint64(statBuffer.st_mtim.tv_sec) * 1000000000 + statBuffer.st_mtim.tv_nsec;
+#endif
+    entry->size = statBuffer.st_size;
+    entry->typeId = 0;
+    entry->reserved = 0;
+    return true;
+#else
+    // No inode numbers from the stat of other platforms
+    Q_UNUSED(filePath);
+    Q_UNUSED(entry);
+    return false;
+#endif
+}
+
+QString QMimeFileIndexPrivate::loadedMimeTypeName(const QMimeFileIndexEntry &identity) const
+{
+    const QMimeFileIndexEntry *end = m_loadedEntries + m_loadedCount;
+    const QMimeFileIndexEntry *it = std::lower_bound(m_loadedEntries, end, identity, lessIdentity);
+    if (it == end || !sameIdentity(*it, identity))
+        return QString();
+    if (it->mtime != identity.mtime || it->size != identity.size || it->typeId >= quint32(m_loadedTypeNames.count()))
+        return QString();
+    return m_loadedTypeNames.at(it->typeId);
+}
+
+void QMimeFileIndexPrivate::record(const QMimeFileIndexEntry &identity, const QString &mimeTypeName, bool reused)
+{
+    QMutexLocker locker(&m_mutex);
+    if (reused)
+        ++m_reusedCount;
+    QHash<QString, quint32>::const_iterator it = m_typeIds.constFind(mimeTypeName);
+    if (it == m_typeIds.constEnd()) {
+        it = m_typeIds.insert(mimeTypeName, m_typeNames.count());
+        m_typeNames.append(mimeTypeName);
+    }
+    m_entries.append(identity);
+    m_entries.last().typeId = it.value();
+}
+
+/*!
+    \class QMimeFileIndex
+    \brief The QMimeFileIndex class remembers the MIME types of files between runs.
+
+    The index records the MIME type of each file along with its identity: the device
+    and inode numbers, the modification time and the size. Saved to disk, it lets the
+    next scan of the same tree reuse the MIME type of the files which didn't change,
+    for the cost of a stat, and only read the new or modified files.
+
+    The index file is mapped in memory by load(), so large indexes load instantly.
+    Only the files looked up or classified since load() are written by save(): after
+    scanning the whole tree, the files which were deleted are dropped from the index.
+
+    Use it with QMimeDirectoryScanner::setIndex() to classify directory trees, or call
+    findByFile() directly. Files are only indexed on Unix.
+
+    \sa QMimeDirectoryScanner
+*/
+
+/*!
+    Creates an empty index.
+*/
+QMimeFileIndex::QMimeFileIndex()
+    : d(new QMimeFileIndexPrivate)
+{
+}
+
+QMimeFileIndex::~QMimeFileIndex()
+{
+    d->unload();
+    delete d;
+}
+
+/*!
+    Maps the index saved in \a indexPath, replacing the contents of this index.
+
+    Returns false, leaving the index empty, if the file is missing or isn't an
+    index written by this version of QMimeFileIndex on this kind of machine,
+    or if the MIME database changed since the index was saved: the types it
+    records might not be the ones found now.
+*/
+bool QMimeFileIndex::load(const QString &indexPath)
+{
+    d->unload();
+    d->m_fingerprint = QMimeDatabasePrivate::instance()->fingerprint();
+
+    d->m_file.setFileName(indexPath);
+    if (!d->m_file.open(QIODevice::ReadOnly))
+        return false;
+    const qint64 fileSize = d->m_file.size();
+
+    QMimeFileIndexHeader header;
+    if (fileSize < qint64(sizeof(header))
+            || d->m_file.read(reinterpret_cast<char *>(&header), sizeof(header)) != qint64(sizeof(header))
+            || memcmp(header.magic, indexMagic, sizeof(indexMagic)) != 0
+            || header.version != IndexVersion || header.byteOrder != IndexByteOrder
+            || QByteArray(header.databaseFingerprint, sizeof(header.databaseFingerprint)) != d->m_fingerprint
+            || header.entriesOffset != sizeof(header)
+            || header.entryCount > quint64(fileSize - sizeof(header)) / sizeof(QMimeFileIndexEntry)
+            || header.entryCount > INT_MAX
+            || header.typesOffset < header.entriesOffset + header.entryCount * sizeof(QMimeFileIndexEntry)
+            || header.typesOffset > quint64(fileSize)) {
+        d->m_file.close();
+        return false;
+    }
+
+    // The type names are few, read them rather than mapping them
+    d->m_file.seek(header.typesOffset);
+    const QList<QByteArray> names = d->m_file.readAll().split('\0');
+    if (quint64(names.count()) <= header.typeCount) { // the last one is after the last NUL
+        d->m_file.close();
+        return false;
+    }
+    for (quint64 i = 0; i < header.typeCount; ++i)
+        d->m_loadedTypeNames.append(QString::fromLatin1(names.at(int(i)).constData()));
+
+    if (header.entryCount > 0) {
+        d->m_map = d->m_file.map(0, header.typesOffset);
+        if (!d->m_map) {
+            d->unload();
+            return false;
+        }
+        d->m_loadedEntries = reinterpret_cast<const QMimeFileIndexEntry *>(d->m_map + header.entriesOffset);
+        d->m_loadedCount = int(header.entryCount);
+    }
+
+    d->m_typeNames = d->m_loadedTypeNames;
+    for (int i = 0; i < d->m_typeNames.count(); ++i)
+        d->m_typeIds.insert(d->m_typeNames.at(i), i);
+    return true;
+}
+
+/*!
+    Writes the files looked up or classified since load() to \a indexPath.
+
+    The index is written to a new file first, which then replaces \a indexPath,
+    so that an interrupted save doesn't damage the previous index.
+*/
+bool QMimeFileIndex::save(const QString &indexPath) const
+{
+    QVector<QMimeFileIndexEntry> entries;
+    QStringList typeNames;
+    {
+        QMutexLocker locker(&d->m_mutex);
+        entries = d->m_entries;
+        typeNames = d->m_typeNames;
+    }
+    // Hard links are found once per path
+    std::sort(entries.begin(), entries.end(), lessIdentity);
+    entries.erase(std::unique(entries.begin(), entries.end(), sameIdentity), entries.end());
+
+    QMimeFileIndexHeader header;
+    memcpy(header.magic, indexMagic, sizeof(indexMagic));
+    header.version = IndexVersion;
+    header.byteOrder = IndexByteOrder;
+    // The one of load(): if the database changed since, some of the types may be out of date
+    const QByteArray fingerprint = d->m_fingerprint.isEmpty()
+            ? QMimeDatabasePrivate::instance()->fingerprint() : d->m_fingerprint;
+    memset(header.databaseFingerprint, 0, sizeof(header.databaseFingerprint));
+    memcpy(header.databaseFingerprint, fingerprint.constData(),
+           qMin(fingerprint.size(), int(sizeof(header.databaseFingerprint))));
+    header.entryCount = entries.count();
+    header.entriesOffset = sizeof(header);
+    header.typeCount = typeNames.count();
+    header.typesOffset = header.entriesOffset + header.entryCount * sizeof(QMimeFileIndexEntry);
+
+    QByteArray types;
+    foreach (const QString &typeName, typeNames) {
+        types += typeName.toLatin1();
+        types += '\0';
+    }
+
+    const QString newPath = indexPath + QLatin1String(".new");
+    QFile file(newPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    const qint64 entriesSize = qint64(entries.count()) * sizeof(QMimeFileIndexEntry);
+    if (file.write(reinterpret_cast<const char *>(&header), sizeof(header)) != qint64(sizeof(header))
+            || file.write(reinterpret_cast<const char *>(entries.constData()), entriesSize) != entriesSize
+            || file.write(types) != types.size()
+            || !file.flush()) {
+        file.close();
+        file.remove();
+        return false;
+    }
+    file.close();
+
+#ifdef Q_OS_UNIX
+    // Replaces the old index atomically; a loaded one stays mapped
+    return ::rename(QFile::encodeName(newPath).constData(), QFile::encodeName(indexPath).constData()) == 0;
+#else
+    QFile::remove(indexPath);
+    return QFile::rename(newPath, indexPath);
+#endif
+}
+
+/*!
+    Returns the number of files in the index loaded by load().
+*/
+int QMimeFileIndex::loadedCount() const
+{
+    return d->m_loadedCount;
+}
+
+/*!
+    Returns the number of files looked up or classified since load(),
+    which is what save() writes.
+*/
+int QMimeFileIndex::count() const
+{
+    QMutexLocker locker(&d->m_mutex);
+    return d->m_entries.count();
+}
+
+/*!
+    Returns how many of the files looked up or classified since load()
+    were unchanged, so that their recorded MIME type was used.
+*/
+int QMimeFileIndex::reusedCount() const
+{
+    QMutexLocker locker(&d->m_mutex);
+    return d->m_reusedCount;
+}
+
+/*!
+    Returns the MIME type recorded for \a filePath if the file didn't change,
+    otherwise QMimeDatabase::findByFile() and records the result.
+*/
+QMimeType QMimeFileIndex::findByFile(const QString &filePath)
+{
+    QMimeDatabase db;
+    QMimeFileIndexEntry identity;
+    if (!QMimeFileIndexPrivate::identify(filePath, &identity))
+        return db.findByFile(filePath);
+
+    const QString mimeTypeName = d->loadedMimeTypeName(identity);
+    if (!mimeTypeName.isEmpty()) {
+        const QMimeType mime = db.mimeTypeForName(mimeTypeName);
+        if (mime.isValid()) {
+            d->record(identity, mimeTypeName, true);
+            return mime;
+        }
+    }
+    const QMimeType mime = db.findByFile(filePath);
+    d->record(identity, mime.name());
+    return mime;
+}
+
+/*!
+    Returns the name of the MIME type recorded by the loaded index for \a filePath,
+    or an empty string if the file isn't indexed or changed since.
+*/
+QString QMimeFileIndex::recordedMimeTypeName(const QString &filePath) const
+{
+    QMimeFileIndexEntry identity;
+    if (!QMimeFileIndexPrivate::identify(filePath, &identity))
+        return QString();
+    return d->loadedMimeTypeName(identity);
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,56 @@
+/****************************************************************************
+**
+** This file is part of QMime
+**
+** Based on Qt Creator source code
+**
+** Qt Creator Copyright (c) 2011 Nokia Corporation and/or its subsidiary(-ies).
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QMIMEFILEINDEX_H_INCLUDED
+#define QMIMEFILEINDEX_H_INCLUDED
+
+#include "qmime_global.h"
+
+#include "qmimetype.h"
+
+QT_BEGIN_NAMESPACE
+
+class QMimeFileIndexPrivate;
+class QMIME_EXPORT QMimeFileIndex
+{
+    Q_DISABLE_COPY(QMimeFileIndex)
+
+public:
+    QMimeFileIndex();
+    ~QMimeFileIndex();
+
+    bool load(const QString &indexPath);
+    bool save(const QString &indexPath) const;
+
+    int loadedCount() const;
+    int count() const;
+    int reusedCount() const;
+
+    QMimeType findByFile(const QString &filePath);
+    QString recordedMimeTypeName(const QString &filePath) const;
+
+private:
+    friend class QMimeDirectoryScannerPrivate;
+    QMimeFileIndexPrivate *d;
+};
+
+QT_END_NAMESPACE
+
+#endif   // QMIMEFILEINDEX_H_INCLUDED
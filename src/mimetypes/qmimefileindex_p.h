@@ -0,0 +1,90 @@
+/****************************************************************************
+**
+** This file is part of QMime
+**
+** Based on Qt Creator source code
+**
+** Qt Creator Copyright (c) 2011 Nokia Corporation and/or its subsidiary(-ies).
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QMIMEFILEINDEX_P_H_INCLUDED
+#define QMIMEFILEINDEX_P_H_INCLUDED
+
+#include "qmimefileindex.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+QT_BEGIN_NAMESPACE
+
+// The index file starts with this header, in the byte order of the machine
+// which wrote it. The entries follow, sorted by device and inode, then the
+// NUL-terminated names of the MIME types, which the entries refer to by number.
+struct QMimeFileIndexHeader
+{
+    char magic[8]; // "QMIMEIDX"
+    quint32 version;
+    quint32 byteOrder; // 0x01020304
+    char databaseFingerprint[16]; // of the MIME database the types were found with
+    quint64 entryCount;
+    quint64 entriesOffset;
+    quint64 typeCount;
+    quint64 typesOffset;
+};
+
+// The identity of a file, and its MIME type as long as the identity is the same
+struct QMimeFileIndexEntry
+{
+    quint64 device;
+    quint64 inode;
+    qint64 mtime; // in nanoseconds
+    qint64 size;
+    quint32 typeId;
+    quint32 reserved;
+};
+
+class QMimeFileIndexPrivate
+{
+public:
+    QMimeFileIndexPrivate();
+
+    void unload();
+
+    // Fills in the identity of the file, false if it has none (not on Unix, or no such file)
+    static bool identify(const QString &filePath, QMimeFileIndexEntry *entry);
+    // The name of the type loaded for an unchanged file, or an empty string
+    QString loadedMimeTypeName(const QMimeFileIndexEntry &identity) const;
+    // Can be called from several threads
+    void record(const QMimeFileIndexEntry &identity, const QString &mimeTypeName, bool reused = false);
+
+    QFile m_file;
+    uchar *m_map;
+    const QMimeFileIndexEntry *m_loadedEntries;
+    int m_loadedCount;
+    QStringList m_loadedTypeNames;
+    QByteArray m_fingerprint; // of the MIME database when the index was loaded
+
+    mutable QMutex m_mutex;
+    QVector<QMimeFileIndexEntry> m_entries;
+    QStringList m_typeNames;
+    QHash<QString, quint32> m_typeIds;
+    int m_reusedCount;
+};
+
+QT_END_NAMESPACE
+
+#endif   // QMIMEFILEINDEX_P_H_INCLUDED
@@ -1,4 +1,5 @@
 #include "qmimeglobpattern_p.h"
+#include "qmimedatabase_p.h"
 
 #include <QRegExp>
 #include <QStringList>
@@ -146,29 +147,39 @@ void QMimeAllGlobPatterns::removeMimeType(const QString& mimeType)
 }
 
 void QMimeGlobPatternList::match(QMimeGlobMatchResult &result,
-                                 const QString &fileName) const
+                                 const QString &fileName, QMimeTraceStage *stage) const
 {
+    if (stage)
+        stage->addRulesTried(count());
 
     QMimeGlobPatternList::const_iterator it = this->constBegin();
     const QMimeGlobPatternList::const_iterator endIt = this->constEnd();
     for (; it != endIt; ++it) {
         const QMimeGlobPattern &glob = *it;
-        if (glob.matchFileName(fileName))
+        if (glob.matchFileName(fileName)) {
             result.addMatch(glob.mimeType(), glob.weight(), glob.pattern());
+            if (stage)
+                stage->addCandidate(glob.mimeType(), glob.weight(), glob.pattern());
+        }
     }
 }
 
-QStringList QMimeAllGlobPatterns::matchingGlobs(const QString &fileName, QString *foundSuffix) const
+QStringList QMimeAllGlobPatterns::matchingGlobs(const QString &fileName, QString *foundSuffix, int *weightPtr, bool *fastPatternMatched,
+                                                QMimeLookupTrace *trace) const
 {
     // First try the high weight matches (>50), if any.
     QMimeGlobMatchResult result;
-    m_highWeightGlobs.match(result, fileName);
+    {
+        QMimeTraceStage stage(trace, "highWeightGlobs");
+        m_highWeightGlobs.match(result, fileName, trace ? &stage : 0);
+    }
     if (result.m_matchingMimeTypes.isEmpty()) {
 
         // Now use the "fast patterns" dict, for simple *.foo patterns with weight 50
         // (which is most of them, so this optimization is definitely worth it)
         const int lastDot = fileName.lastIndexOf(QLatin1Char('.'));
         if (lastDot != -1) { // if no '.', skip the extension lookup
+            QMimeTraceStage stage(trace, "fastPatterns");
             const int ext_len = fileName.length() - lastDot - 1;
             const QString simpleExtension = fileName.right(ext_len).toLower();
             // (toLower because fast patterns are always case-insensitive and saved as lowercase)
@@ -176,15 +187,23 @@ QStringList QMimeAllGlobPatterns::matchingGlobs(const QString &fileName, QString
             const QStringList matchingMimeTypes = m_fastPatterns.value(simpleExtension);
             foreach (const QString &mime, matchingMimeTypes) {
                 result.addMatch(mime, 50, QLatin1String("*.") + simpleExtension);
+                if (stage.isActive())
+                    stage.addCandidate(mime, 50, QLatin1String("*.") + simpleExtension);
             }
+            stage.addRulesTried(1);
+            if (fastPatternMatched && !matchingMimeTypes.isEmpty())
+                *fastPatternMatched = true;
             // Can't return yet; *.tar.bz2 has to win over *.bz2, so we need the low-weight mimetypes anyway,
             // at least those with weight 50.
         }
 
         // Finally, try the low weight matches (<=50)
-        m_lowWeightGlobs.match(result, fileName);
+        QMimeTraceStage stage(trace, "lowWeightGlobs");
+        m_lowWeightGlobs.match(result, fileName, trace ? &stage : 0);
     }
     if (foundSuffix)
         *foundSuffix = result.m_foundSuffix;
+    if (weightPtr)
+        *weightPtr = result.m_weight;
     return result.m_matchingMimeTypes;
 }
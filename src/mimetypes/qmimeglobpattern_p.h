@@ -4,6 +4,9 @@
 #include <QStringList>
 #include <QHash>
 
+struct QMimeLookupTrace;
+class QMimeTraceStage;
+
 struct QMimeGlobMatchResult
 {
     QMimeGlobMatchResult()
@@ -77,7 +80,7 @@ public:
         }
     }
 
-    void match(QMimeGlobMatchResult &result, const QString &fileName) const;
+    void match(QMimeGlobMatchResult &result, const QString &fileName, QMimeTraceStage *stage = 0) const;
 };
 
 /*!
@@ -94,7 +97,8 @@ public:
 
     void addGlob(const QMimeGlobPattern &glob);
     void removeMimeType(const QString &mimeType);
-    QStringList matchingGlobs(const QString &fileName, QString *foundSuffix) const;
+    QStringList matchingGlobs(const QString &fileName, QString *foundSuffix, int *weightPtr = 0, bool *fastPatternMatched = 0,
+                              QMimeLookupTrace *trace = 0) const;
 
     PatternsMap m_fastPatterns; // example: "doc" -> "application/msword", "text/plain"
     QMimeGlobPatternList m_highWeightGlobs;
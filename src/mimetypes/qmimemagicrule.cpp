@@ -339,6 +339,35 @@ QByteArray QMimeMagicRule::mask() const
     return result;
 }
 
+// How many bytes of data the rule and its submatches can look at
+int QMimeMagicRule::extent() const
+{
+    int valueLength;
+    switch (d->type) {
+    case String:
+        valueLength = d->pattern.size();
+        break;
+    case Host16:
+    case Big16:
+    case Little16:
+        valueLength = 2;
+        break;
+    case Host32:
+    case Big32:
+    case Little32:
+        valueLength = 4;
+        break;
+    default:
+        valueLength = 1;
+        break;
+    }
+    // matchNumber() looks one position past endPos
+    int result = d->endPos + 1 + valueLength;
+    foreach (const QMimeMagicRule &subMatch, m_subMatches)
+        result = qMax(result, subMatch.extent());
+    return result;
+}
+
 bool QMimeMagicRule::isValid() const
 {
     return d->matchFunction;
@@ -21,6 +21,8 @@
 #ifndef QMIMEMAGICRULE_P_H
 #define QMIMEMAGICRULE_P_H
 
+#include "qmime_global.h"
+
 #include <QtCore/QByteArray>
 #include <QtCore/QScopedPointer>
 #include <QtCore/QList>
@@ -28,7 +30,7 @@
 QT_BEGIN_NAMESPACE
 
 class QMimeMagicRulePrivate;
-class QMimeMagicRule
+class QMIME_EXPORT QMimeMagicRule
 {
 public:
     enum Type { Invalid = 0, String, Host16, Host32, Big16, Big32, Little16, Little32, Byte };
@@ -46,6 +48,7 @@ public:
     int startPos() const;
     int endPos() const;
     QByteArray mask() const;
+    int extent() const;
 
     bool isValid() const;
 
@@ -0,0 +1,163 @@
+/****************************************************************************
+**
+** This file is part of QMime
+**
+** Based on Qt Creator source code
+**
+** Qt Creator Copyright (c) 2011 Nokia Corporation and/or its subsidiary(-ies).
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#include "qmimenamecache_p.h"
+
+#include "qmimeprovider_p.h"
+
+QT_BEGIN_NAMESPACE
+
+// Whether the matches of the pattern only depend on the part of the names from their
+// first dot: "*X" where X starts with a dot, or can't match a dot at all
+static bool isSuffixPattern(const QString &pattern)
+{
+    if (!pattern.startsWith(QLatin1Char('*')) || pattern.lastIndexOf(QLatin1Char('*')) != 0)
+        return false;
+    if (pattern.length() > 1 && pattern.at(1) == QLatin1Char('.'))
+        return true;
+    return !pattern.contains(QLatin1Char('.')) && !pattern.contains(QLatin1Char('?'))
+        && !pattern.contains(QLatin1Char('['));
+}
+
+QMimeNameCache::QMimeNameCache()
+    : m_capacity(0), m_first(0), m_last(0), m_stemPatternsLoaded(false)
+{
+}
+
+QMimeNameCache::~QMimeNameCache()
+{
+    clear();
+}
+
+void QMimeNameCache::setCapacity(int capacity)
+{
+    m_capacity = qMax(0, capacity);
+    while (m_nodes.count() > m_capacity) {
+        Node *node = m_last;
+        unlink(node);
+        m_nodes.remove(node->key);
+        delete node;
+    }
+}
+
+void QMimeNameCache::clear()
+{
+    qDeleteAll(m_nodes);
+    m_nodes.clear();
+    m_first = m_last = 0;
+    m_stemPatternsLoaded = false;
+    m_stemPatterns.clear();
+}
+
+QString QMimeNameCache::key(QMimeProviderBase *provider, const QString &fileName)
+{
+    if (!m_stemPatternsLoaded) {
+        foreach (const QString &pattern, provider->allGlobPatterns()) {
+            if (!isSuffixPattern(pattern))
+                m_stemPatterns.append(QMimeGlobPattern(pattern.toLower(), QString(), QMimeGlobPattern::DefaultWeight,
+                                                       Qt::CaseSensitive));
+        }
+        m_stemPatternsLoaded = true;
+    }
+
+    // The patterns are matched case-insensitively, which might exclude more names than
+    // needed, but lowers the name only once
+    const QString lowerFileName = fileName.toLower();
+    QMimeGlobPatternList::const_iterator it = m_stemPatterns.constBegin();
+    const QMimeGlobPatternList::const_iterator end = m_stemPatterns.constEnd();
+    for (; it != end; ++it) {
+        if ((*it).matchFileName(lowerFileName))
+            return QString();
+    }
+
+    // Hidden files and names without an extension are cached under their whole name,
+    // which can't be mistaken for an extension: ".tar.gz" doesn't match *.tar.gz as
+    // "foo.tar.gz" does, so it can't share the key of the names ending in ".gz"
+    if (fileName.startsWith(QLatin1Char('.')))
+        return QLatin1Char('/') + fileName;
+    const int firstDot = fileName.indexOf(QLatin1Char('.'));
+    if (firstDot == -1)
+        return QLatin1Char('/') + fileName;
+    return fileName.mid(firstDot);
+}
+
+bool QMimeNameCache::find(const QString &key, QStringList *matches, QString *foundSuffix, int *weightPtr)
+{
+    Node *node = m_nodes.value(key);
+    if (!node)
+        return false;
+    if (node != m_first) {
+        unlink(node);
+        prepend(node);
+    }
+    *matches = node->matches;
+    if (foundSuffix)
+        *foundSuffix = node->foundSuffix;
+    if (weightPtr)
+        *weightPtr = node->weight;
+    return true;
+}
+
+void QMimeNameCache::insert(const QString &key, const QStringList &matches, const QString &foundSuffix, int weight)
+{
+    if (m_capacity == 0 || m_nodes.contains(key))
+        return;
+
+    Node *node;
+    if (m_nodes.count() == m_capacity) {
+        // Reuse the least recently used node
+        node = m_last;
+        unlink(node);
+        m_nodes.remove(node->key);
+    } else {
+        node = new Node;
+    }
+    node->key = key;
+    node->matches = matches;
+    node->foundSuffix = foundSuffix;
+    node->weight = weight;
+    prepend(node);
+    m_nodes.insert(key, node);
+}
+
+void QMimeNameCache::unlink(Node *node)
+{
+    if (node->previous)
+        node->previous->next = node->next;
+    else
+        m_first = node->next;
+    if (node->next)
+        node->next->previous = node->previous;
+    else
+        m_last = node->previous;
+}
+
+void QMimeNameCache::prepend(Node *node)
+{
+    node->previous = 0;
+    node->next = m_first;
+    if (m_first)
+        m_first->previous = node;
+    else
+        m_last = node;
+    m_first = node;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,82 @@
+/****************************************************************************
+**
+** This file is part of QMime
+**
+** Based on Qt Creator source code
+**
+** Qt Creator Copyright (c) 2011 Nokia Corporation and/or its subsidiary(-ies).
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+****************************************************************************/
+
+#ifndef QMIMENAMECACHE_P_H_INCLUDED
+#define QMIMENAMECACHE_P_H_INCLUDED
+
+#include <QtCore/QHash>
+#include <QtCore/QStringList>
+
+#include "qmimeglobpattern_p.h"
+
+QT_BEGIN_NAMESPACE
+
+class QMimeProviderBase;
+
+/*
+   Remembers the glob matches of the most recently used file names, keyed by the
+   part of the name from its first dot: "foo.tar.gz" and "bar.tar.gz" only differ
+   for the few patterns which look at the rest of the name (like "README*" or
+   "Makefile"), and the names those match aren't cached.
+   Not thread-safe, used with the database locked.
+ */
+class QMimeNameCache
+{
+public:
+    QMimeNameCache();
+    ~QMimeNameCache();
+
+    int capacity() const { return m_capacity; }
+    void setCapacity(int capacity);
+    // To be called when the provider changes
+    void clear();
+
+    // The key of fileName (without a path), or an empty string if it can't be cached
+    QString key(QMimeProviderBase *provider, const QString &fileName);
+    bool find(const QString &key, QStringList *matches, QString *foundSuffix, int *weightPtr);
+    void insert(const QString &key, const QStringList &matches, const QString &foundSuffix, int weight);
+
+private:
+    Q_DISABLE_COPY(QMimeNameCache)
+
+    struct Node
+    {
+        QString key;
+        QStringList matches;
+        QString foundSuffix;
+        int weight;
+        Node *previous;
+        Node *next;
+    };
+
+    void unlink(Node *node);
+    void prepend(Node *node);
+
+    int m_capacity;
+    QHash<QString, Node *> m_nodes;
+    Node *m_first; // the most recently used
+    Node *m_last;
+    bool m_stemPatternsLoaded;
+    QMimeGlobPatternList m_stemPatterns;
+};
+
+QT_END_NAMESPACE
+
+#endif   // QMIMENAMECACHE_P_H_INCLUDED
@@ -26,11 +26,19 @@
 
 #include <QXmlStreamReader>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QPair>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
 #include <QByteArrayMatcher>
 #include <QDebug>
 #include <qendian.h>
 
+#include <algorithm>
+
 static QString fallbackParent(const QString& mimeTypeName)
 {
     const QString myGroup = mimeTypeName.left(mimeTypeName.indexOf(QLatin1Char('/')));
@@ -48,12 +56,45 @@ static QString fallbackParent(const QString& mimeTypeName)
 }
 
 QMimeProviderBase::QMimeProviderBase(QMimeDatabasePrivate *db)
-    : m_db(db)
+    : m_db(db), m_loadTime(0)
+{
+}
+
+// Rough sizes of the data structures, for statistics()
+enum {
+    StringHeaderSize = 3 * sizeof(void *),
+    HashNodeOverhead = 2 * sizeof(void *),
+    ListNodeSize = sizeof(void *)
+};
+
+static qint64 stringDataSize(const QString &str)
+{
+    return str.isNull() ? 0 : StringHeaderSize + (str.size() + 1) * sizeof(QChar);
+}
+
+// The comment texts aren't shared, the locale keys are counted by the string pool
+static qint64 commentsSize(const QHash<QString, QString> &localeComments)
 {
+    qint64 size = 0;
+    QHash<QString, QString>::const_iterator it = localeComments.constBegin();
+    for ( ; it != localeComments.constEnd(); ++it)
+        size += HashNodeOverhead + 2 * sizeof(QString) + stringDataSize(it.value());
+    return size;
+}
+
+static qint64 magicRulesSize(const QList<QMimeMagicRule> &rules)
+{
+    qint64 size = 0;
+    foreach (const QMimeMagicRule &rule, rules) {
+        size += ListNodeSize + sizeof(QMimeMagicRule) + rule.value().size() + rule.mask().size();
+        size += magicRulesSize(rule.m_subMatches);
+    }
+    return size;
 }
 
 QMimeBinaryProvider::QMimeBinaryProvider(QMimeDatabasePrivate *db)
-    : QMimeProviderBase(db)
+    : QMimeProviderBase(db), m_mimetypeListLoaded(false), m_mimetypeListGeneration(0),
+      m_otherLocaleCommentsGeneration(0)
 {
 }
 
@@ -80,10 +121,13 @@ struct QMimeBinaryProvider::CacheFile
     QFile *file;
     uchar *data;
     bool m_valid;
+    // Type name -> indexes of its magic matches, built on first use
+    QHash<QByteArray, QList<int> > magicMatchIndexes;
+    bool magicMatchIndexesBuilt;
 };
 
 QMimeBinaryProvider::CacheFile::CacheFile(QFile *f)
-    : file(f), m_valid(false)
+    : file(f), m_valid(false), magicMatchIndexesBuilt(false)
 {
     data = file->map(0, file->size());
     if (data) {
@@ -122,7 +166,10 @@ bool QMimeBinaryProvider::isValid()
         return false;
     }
 
-    const QStringList cacheFilenames = QStandardPaths::locateAll(QStandardPaths::GenericDataLocation, QLatin1String("mime/mime.cache"));
+    QElapsedTimer timer;
+    timer.start();
+
+    const QStringList cacheFilenames = m_db->m_directoryCache.locateAll(QLatin1String("mime.cache"));
     qDeleteAll(m_cacheFiles);
     m_cacheFiles.clear();
 
@@ -138,6 +185,7 @@ bool QMimeBinaryProvider::isValid()
         } else
             delete file;
     }
+    m_loadTime += timer.elapsed();
 
     if (m_cacheFiles.count() > 1)
         return true;
@@ -165,29 +213,44 @@ QMimeType QMimeBinaryProvider::mimeTypeForName(const QString &name)
     return QMimeType(data);
 }
 
-QStringList QMimeBinaryProvider::findByName(const QString &fileName, QString *foundSuffix)
+QStringList QMimeBinaryProvider::findByName(const QString &fileName, QString *foundSuffix, int *weightPtr)
 {
     const QString lowerFileName = fileName.toLower();
     QMimeGlobMatchResult result;
+    bool suffixTreeMatched = false;
     // TODO this parses in the order (local, global). Check that it handles "NOGLOBS" correctly.
     foreach (CacheFile *cacheFile, m_cacheFiles) {
-        matchGlobList(result, cacheFile, cacheFile->getUint32(PosLiteralListOffset), fileName);
-        matchGlobList(result, cacheFile, cacheFile->getUint32(PosGlobListOffset), fileName);
+        {
+            QMimeTraceStage stage(m_db->m_trace, "literals");
+            matchGlobList(result, cacheFile, cacheFile->getUint32(PosLiteralListOffset), fileName, stage);
+        }
+        {
+            QMimeTraceStage stage(m_db->m_trace, "globs");
+            matchGlobList(result, cacheFile, cacheFile->getUint32(PosGlobListOffset), fileName, stage);
+        }
+        QMimeTraceStage stage(m_db->m_trace, "suffixTree");
         const int reverseSuffixTreeOffset = cacheFile->getUint32(PosReverseSuffixTreeOffset);
         const int numRoots = cacheFile->getUint32(reverseSuffixTreeOffset);
         const int firstRootOffset = cacheFile->getUint32(reverseSuffixTreeOffset + 4);
-        matchSuffixTree(result, cacheFile, numRoots, firstRootOffset, lowerFileName, fileName.length() - 1, false);
-        if (result.m_matchingMimeTypes.isEmpty())
-            matchSuffixTree(result, cacheFile, numRoots, firstRootOffset, fileName, fileName.length() - 1, true);
+        if (matchSuffixTree(result, cacheFile, numRoots, firstRootOffset, lowerFileName, fileName.length() - 1, false, stage))
+            suffixTreeMatched = true;
+        else if (result.m_matchingMimeTypes.isEmpty()
+                 && matchSuffixTree(result, cacheFile, numRoots, firstRootOffset, fileName, fileName.length() - 1, true, stage))
+            suffixTreeMatched = true;
     }
+    if (suffixTreeMatched && m_db->countersEnabled())
+        ++m_db->m_counters.fastGlobHits;
     if (foundSuffix)
         *foundSuffix = result.m_foundSuffix;
+    if (weightPtr)
+        *weightPtr = result.m_weight;
     return result.m_matchingMimeTypes;
 }
 
-void QMimeBinaryProvider::matchGlobList(QMimeGlobMatchResult& result, CacheFile *cacheFile, int off, const QString &fileName)
+void QMimeBinaryProvider::matchGlobList(QMimeGlobMatchResult& result, CacheFile *cacheFile, int off, const QString &fileName, QMimeTraceStage &stage)
 {
     const int numGlobs = cacheFile->getUint32(off);
+    stage.addRulesTried(numGlobs);
     //qDebug() << "Loading" << numGlobs << "globs from" << cacheFile->file->fileName() << "at offset" << cacheFile->globListOffset;
     for (int i = 0; i < numGlobs; ++i) {
         const int globOffset = cacheFile->getUint32(off + 4 + 12 * i);
@@ -203,13 +266,17 @@ void QMimeBinaryProvider::matchGlobList(QMimeGlobMatchResult& result, CacheFile
         QMimeGlobPattern glob(pattern, QString() /*unused*/, weight, qtCaseSensitive);
 
         // TODO: this could be done faster for literals where a simple == would do.
-        if (glob.matchFileName(fileName))
+        if (glob.matchFileName(fileName)) {
             result.addMatch(QLatin1String(mimeType), weight, pattern);
+            if (stage.isActive())
+                stage.addCandidate(QLatin1String(mimeType), weight, pattern);
+        }
     }
 }
 
-bool QMimeBinaryProvider::matchSuffixTree(QMimeGlobMatchResult& result, QMimeBinaryProvider::CacheFile *cacheFile, int numEntries, int firstOffset, const QString &fileName, int charPos, bool caseSensitiveCheck)
+bool QMimeBinaryProvider::matchSuffixTree(QMimeGlobMatchResult& result, QMimeBinaryProvider::CacheFile *cacheFile, int numEntries, int firstOffset, const QString &fileName, int charPos, bool caseSensitiveCheck, QMimeTraceStage &stage)
 {
+    stage.addRulesTried(1);
     QChar fileChar = fileName[charPos];
     int min = 0;
     int max = numEntries - 1;
@@ -227,7 +294,7 @@ bool QMimeBinaryProvider::matchSuffixTree(QMimeGlobMatchResult& result, QMimeBin
             int childrenOffset = cacheFile->getUint32(off + 8);
             bool success = false;
             if (charPos > 0)
-                success = matchSuffixTree(result, cacheFile, numChildren, childrenOffset, fileName, charPos, caseSensitiveCheck);
+                success = matchSuffixTree(result, cacheFile, numChildren, childrenOffset, fileName, charPos, caseSensitiveCheck, stage);
             if (!success) {
                 for (int i = 0; i < numChildren; ++i) {
                     const int childOff = childrenOffset + 12 * i;
@@ -241,6 +308,8 @@ bool QMimeBinaryProvider::matchSuffixTree(QMimeGlobMatchResult& result, QMimeBin
                     const bool caseSensitive = flagsAndWeight & 0x100;
                     if (caseSensitiveCheck || !caseSensitive) {
                         result.addMatch(QLatin1String(mimeType), weight, QLatin1Char('*') + fileName.mid(charPos+1));
+                        if (stage.isActive())
+                            stage.addCandidate(QLatin1String(mimeType), weight, QLatin1Char('*') + fileName.mid(charPos+1));
                         success = true;
                     }
                 }
@@ -281,6 +350,8 @@ bool QMimeBinaryProvider::matchMagicRule(QMimeBinaryProvider::CacheFile *cacheFi
 
 QMimeType QMimeBinaryProvider::findByMagic(const QByteArray &data, int *accuracyPtr)
 {
+    QMimeTraceStage stage(m_db->m_trace, "magic");
+    stage.addBytesExamined(data.size());
     foreach (CacheFile *cacheFile, m_cacheFiles) {
         const int magicListOffset = cacheFile->getUint32(PosMagicListOffset);
         const int numMatches = cacheFile->getUint32(magicListOffset);
@@ -288,22 +359,83 @@ QMimeType QMimeBinaryProvider::findByMagic(const QByteArray &data, int *accuracy
         const int firstMatchOffset = cacheFile->getUint32(magicListOffset + 8);
 
         for (int i = 0; i < numMatches; ++i) {
-            const int off = firstMatchOffset + i * 16;
-            const int numMatchlets = cacheFile->getUint32(off + 8);
-            const int firstMatchletOffset = cacheFile->getUint32(off + 12);
-            if (matchMagicRule(cacheFile, numMatchlets, firstMatchletOffset, data)) {
-                const int mimeTypeOffset = cacheFile->getUint32(off + 4);
-                const char* mimeType = cacheFile->getCharStar(mimeTypeOffset);
-                *accuracyPtr = cacheFile->getUint32(off);
-                // Return the first match. We have no rules for conflicting magic data...
-                // (mime.cache itself is sorted, but what about local overrides with a lower prio?)
-                return mimeTypeForName(QLatin1String(mimeType));
+            // The matches are sorted by priority, so there is no better one so far
+            if (m_db->m_deadline && m_db->m_deadline->hasExpired())
+                return QMimeType();
+            const QMimeType mime = matchMagicAt(cacheFile, firstMatchOffset + i * 16, data, accuracyPtr, stage);
+            // Return the first match. We have no rules for conflicting magic data...
+            // (mime.cache itself is sorted, but what about local overrides with a lower prio?)
+            if (mime.isValid())
+                return mime;
+        }
+    }
+    return QMimeType();
+}
+
+QMimeType QMimeBinaryProvider::findByMagicAmong(const QByteArray &data, int *accuracyPtr,
+                                                const QSet<QString> &mimeTypes)
+{
+    QMimeTraceStage stage(m_db->m_trace, "candidateMagic");
+    stage.addBytesExamined(data.size());
+    foreach (CacheFile *cacheFile, m_cacheFiles) {
+        const int magicListOffset = cacheFile->getUint32(PosMagicListOffset);
+        const int firstMatchOffset = cacheFile->getUint32(magicListOffset + 8);
+        if (!cacheFile->magicMatchIndexesBuilt) {
+            const int numMatches = cacheFile->getUint32(magicListOffset);
+            for (int i = 0; i < numMatches; ++i) {
+                const int mimeTypeOffset = cacheFile->getUint32(firstMatchOffset + i * 16 + 4);
+                cacheFile->magicMatchIndexes[QByteArray(cacheFile->getCharStar(mimeTypeOffset))].append(i);
             }
+            cacheFile->magicMatchIndexesBuilt = true;
+        }
+
+        // In the same order as findByMagic(), by priority
+        QList<int> indexes;
+        foreach (const QString &mimeType, mimeTypes)
+            indexes += cacheFile->magicMatchIndexes.value(mimeType.toLatin1());
+        std::sort(indexes.begin(), indexes.end());
+
+        foreach (int i, indexes) {
+            if (m_db->m_deadline && m_db->m_deadline->hasExpired())
+                return QMimeType();
+            const QMimeType mime = matchMagicAt(cacheFile, firstMatchOffset + i * 16, data, accuracyPtr, stage);
+            if (mime.isValid())
+                return mime;
         }
     }
     return QMimeType();
 }
 
+// Returns the type of the magic match at \a off if it matches \a data, an invalid type otherwise
+QMimeType QMimeBinaryProvider::matchMagicAt(CacheFile *cacheFile, int off, const QByteArray &data,
+                                            int *accuracyPtr, QMimeTraceStage &stage)
+{
+    const int numMatchlets = cacheFile->getUint32(off + 8);
+    const int firstMatchletOffset = cacheFile->getUint32(off + 12);
+    if (m_db->countersEnabled())
+        ++m_db->m_counters.magicMatchersEvaluated;
+    stage.addRulesTried(1);
+    if (!matchMagicRule(cacheFile, numMatchlets, firstMatchletOffset, data))
+        return QMimeType();
+
+    const int mimeTypeOffset = cacheFile->getUint32(off + 4);
+    const char* mimeType = cacheFile->getCharStar(mimeTypeOffset);
+    *accuracyPtr = cacheFile->getUint32(off);
+    if (stage.isActive())
+        stage.addCandidate(QLatin1String(mimeType), *accuracyPtr, QLatin1String("magic"));
+    return mimeTypeForName(QLatin1String(mimeType));
+}
+
+int QMimeBinaryProvider::magicMaxExtent()
+{
+    int result = 0;
+    foreach (CacheFile *cacheFile, m_cacheFiles) {
+        const int magicListOffset = cacheFile->getUint32(PosMagicListOffset);
+        result = qMax(result, int(cacheFile->getUint32(magicListOffset + 4)));
+    }
+    return result;
+}
+
 QStringList QMimeBinaryProvider::parents(const QString &mime)
 {
     const QByteArray mimeStr = mime.toLatin1();
@@ -373,14 +505,20 @@ QString QMimeBinaryProvider::resolveAlias(const QString &name)
     return name;
 }
 
-QList<QMimeType> QMimeBinaryProvider::allMimeTypes()
+void QMimeBinaryProvider::checkMimeTypeList()
 {
-    QList<QMimeType> result;
+    const int generation = m_db->m_directoryCache.generation();
+    if (m_mimetypeListLoaded && generation == m_mimetypeListGeneration)
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+
     QSet<QString> mimetypes;
     // Unfortunately mime.cache doesn't have a full list of all mimetypes.
     // So we'll have to parse the plain-text files called "types".
-    // We did say it would be slow, in the documentation :-)
-    const QStringList typesFilenames = QStandardPaths::locateAll(QStandardPaths::GenericDataLocation, QLatin1String("mime/types"));
+    // This is done once, and again only when the mime directories change.
+    const QStringList typesFilenames = m_db->m_directoryCache.locateAll(QLatin1String("types"));
     foreach (const QString& typeFilename, typesFilenames) {
         QFile file(typeFilename);
         if (file.open(QIODevice::ReadOnly)) {
@@ -392,12 +530,99 @@ QList<QMimeType> QMimeBinaryProvider::allMimeTypes()
         }
     }
 
-    for (QSet<QString>::const_iterator it = mimetypes.constBegin();
-          it != mimetypes.constEnd(); ++it) {
-        result.append(mimeTypeForName(*it));
+    m_mimetypeNames = mimetypes.toList();
+    m_mimetypeNames.sort();
+    m_allMimeTypes.clear(); // rebuilt on demand by allMimeTypes()
+    m_mimetypeListGeneration = generation;
+    m_mimetypeListLoaded = true;
+    m_loadTime += timer.elapsed();
+}
+
+int QMimeBinaryProvider::suffixTreeLeafCount(CacheFile *cacheFile, int numEntries, int firstOffset)
+{
+    int count = 0;
+    for (int i = 0; i < numEntries; ++i) {
+        const int off = firstOffset + 12 * i;
+        if (cacheFile->getUint32(off) == 0) // a leaf: a pattern ends here
+            ++count;
+        else
+            count += suffixTreeLeafCount(cacheFile, cacheFile->getUint32(off + 4), cacheFile->getUint32(off + 8));
     }
+    return count;
+}
 
-    return result;
+void QMimeBinaryProvider::addStatistics(QMimeDatabaseStatistics &stats)
+{
+    stats.provider = QLatin1String("mime.cache");
+    checkMimeTypeList();
+    stats.mimeTypeCount = m_mimetypeNames.count();
+    foreach (CacheFile *cacheFile, m_cacheFiles) {
+        stats.mappedBytes += cacheFile->file->size();
+        stats.globPatternCount += cacheFile->getUint32(cacheFile->getUint32(PosLiteralListOffset));
+        stats.globPatternCount += cacheFile->getUint32(cacheFile->getUint32(PosGlobListOffset));
+        const int reverseSuffixTreeOffset = cacheFile->getUint32(PosReverseSuffixTreeOffset);
+        stats.globPatternCount += suffixTreeLeafCount(cacheFile, cacheFile->getUint32(reverseSuffixTreeOffset),
+                                                      cacheFile->getUint32(reverseSuffixTreeOffset + 4));
+        stats.magicMatcherCount += cacheFile->getUint32(cacheFile->getUint32(PosMagicListOffset));
+        stats.heapBytes += ListNodeSize + sizeof(CacheFile) + sizeof(QFile);
+    }
+    // The names are counted here, the types only hold a reference to them
+    foreach (const QString &name, m_mimetypeNames)
+        stats.cacheBytes += ListNodeSize + stringDataSize(name);
+    stats.cacheBytes += m_allMimeTypes.count() * (ListNodeSize + sizeof(QMimeTypePrivate));
+    stats.loadTime += m_loadTime;
+}
+
+QList<QMimeType> QMimeBinaryProvider::allMimeTypes()
+{
+    checkMimeTypeList();
+    if (m_allMimeTypes.isEmpty()) {
+        m_allMimeTypes.reserve(m_mimetypeNames.count());
+        foreach (const QString &name, m_mimetypeNames)
+            m_allMimeTypes.append(mimeTypeForName(name));
+    }
+    return m_allMimeTypes;
+}
+
+QStringList QMimeBinaryProvider::allMimeTypeNames()
+{
+    checkMimeTypeList();
+    return m_mimetypeNames;
+}
+
+QStringList QMimeBinaryProvider::allGlobPatterns()
+{
+    QStringList patterns;
+    foreach (CacheFile *cacheFile, m_cacheFiles) {
+        addGlobListPatterns(cacheFile, cacheFile->getUint32(PosLiteralListOffset), &patterns);
+        addGlobListPatterns(cacheFile, cacheFile->getUint32(PosGlobListOffset), &patterns);
+        const int reverseSuffixTreeOffset = cacheFile->getUint32(PosReverseSuffixTreeOffset);
+        addSuffixTreePatterns(cacheFile, cacheFile->getUint32(reverseSuffixTreeOffset),
+                              cacheFile->getUint32(reverseSuffixTreeOffset + 4), QString(), &patterns);
+    }
+    return patterns;
+}
+
+void QMimeBinaryProvider::addGlobListPatterns(CacheFile *cacheFile, int offset, QStringList *patterns)
+{
+    const int numGlobs = cacheFile->getUint32(offset);
+    for (int i = 0; i < numGlobs; ++i)
+        patterns->append(QLatin1String(cacheFile->getCharStar(cacheFile->getUint32(offset + 4 + 12 * i))));
+}
+
+// The tree is indexed by the last character of the patterns, then the one before, etc.
+void QMimeBinaryProvider::addSuffixTreePatterns(CacheFile *cacheFile, int numEntries, int firstOffset,
+                                                const QString &suffix, QStringList *patterns)
+{
+    for (int i = 0; i < numEntries; ++i) {
+        const int off = firstOffset + 12 * i;
+        const uint ch = cacheFile->getUint32(off);
+        if (ch == 0) // a leaf: a pattern ends here
+            patterns->append(QLatin1Char('*') + suffix);
+        else
+            addSuffixTreePatterns(cacheFile, cacheFile->getUint32(off + 4), cacheFile->getUint32(off + 8),
+                                  QChar(ch) + suffix, patterns);
+    }
 }
 
 void QMimeBinaryProvider::loadMimeTypePrivate(QMimeTypePrivate &data)
@@ -405,18 +630,20 @@ void QMimeBinaryProvider::loadMimeTypePrivate(QMimeTypePrivate &data)
     // load comment and globPatterns
 
     const QString file = data.name + QLatin1String(".xml");
-    const QStringList mimeFiles = QStandardPaths::locateAll(QStandardPaths::GenericDataLocation, QString::fromLatin1("mime/") + file);
+    const QStringList mimeFiles = m_db->m_directoryCache.locateAll(file);
     if (mimeFiles.isEmpty()) {
         // TODO: ask Thiago about this
         qWarning() << "No file found for" << file << ", even though the file appeared in a directory listing.";
         qWarning() << "Either it was just removed, or the directory doesn't have executable permission...";
-        qWarning() << QStandardPaths::locateAll(QStandardPaths::GenericDataLocation, QLatin1String("mime"), QStandardPaths::LocateDirectory);
+        qWarning() << m_db->m_directoryCache.mimeDirectories();
         return;
     }
 
     QString comment;
     QString mainPattern;
     const QString preferredLanguage = QLocale::system().name();
+    // The others are read by loadComment()
+    const QSet<QString> retainedLocales = m_db->retainedLocaleSet();
 
     QListIterator<QString> mimeFilesIter(mimeFiles);
     mimeFilesIter.toBack();
@@ -446,7 +673,8 @@ void QMimeBinaryProvider::loadMimeTypePrivate(QMimeTypePrivate &data)
                     if (lang.isEmpty()) {
                         lang = QLatin1String("en_US");
                     }
-                    data.localeComments.insert(lang, text);
+                    if (retainedLocales.isEmpty() || retainedLocales.contains(lang))
+                        data.localeComments.insert(lang, text);
                     continue; // we called readElementText, so we're at the EndElement already.
                 } else if (tag == "icon") { // as written out by shared-mime-info >= 0.40
                     data.iconName = xml.attributes().value(QLatin1String("name")).toString();
@@ -528,10 +756,54 @@ void QMimeBinaryProvider::loadGenericIcon(QMimeTypePrivate &data)
     }
 }
 
+// Called by QMimeType, without the database mutex locked.
+// Reads the comment in one language which isn't kept by loadMimeTypePrivate(),
+// once per type and language until the directories change.
+QString QMimeBinaryProvider::loadComment(const QMimeTypePrivate &data, const QString &locale)
+{
+    QMutexLocker locker(&m_db->mutex);
+    const int generation = m_db->m_directoryCache.generation();
+    if (generation != m_otherLocaleCommentsGeneration) {
+        m_otherLocaleComments.clear();
+        m_otherLocaleCommentsGeneration = generation;
+    }
+    QHash<QString, QString> &typeComments = m_otherLocaleComments[data.name];
+    QHash<QString, QString>::const_iterator it = typeComments.constFind(locale);
+    if (it != typeComments.constEnd())
+        return it.value();
+
+    QString comment;
+    const QStringList mimeFiles = m_db->m_directoryCache.locateAll(data.name + QLatin1String(".xml"));
+    for (int i = mimeFiles.count() - 1; i >= 0; --i) { // global first, then local.
+        QFile qfile(mimeFiles.at(i));
+        if (!qfile.open(QFile::ReadOnly))
+            continue;
+
+        QXmlStreamReader xml(&qfile);
+        if (!xml.readNextStartElement() || xml.name() != "mime-type")
+            continue;
+        while (xml.readNextStartElement()) {
+            if (xml.name() == "comment") {
+                QString lang = xml.attributes().value(QLatin1String("xml:lang")).toString();
+                if (lang.isEmpty())
+                    lang = QLatin1String("en_US");
+                if (lang == locale) {
+                    comment = xml.readElementText();
+                    continue; // we called readElementText, so we're at the EndElement already.
+                }
+            }
+            xml.skipCurrentElement();
+        }
+    }
+    typeComments.insert(locale, comment);
+    return comment;
+}
+
 ////
 
 QMimeXMLProvider::QMimeXMLProvider(QMimeDatabasePrivate *db)
-    : QMimeProviderBase(db), m_loaded(false)
+    : QMimeProviderBase(db), m_loaded(false), m_magicLoaded(false), m_commentsLoaded(false),
+      m_magicMaxExtent(0)
 {
 }
 
@@ -547,39 +819,97 @@ QMimeType QMimeXMLProvider::mimeTypeForName(const QString &name)
     return m_nameMimeTypeMap.value(name);
 }
 
-QStringList QMimeXMLProvider::findByName(const QString &fileName, QString *foundSuffix)
+QStringList QMimeXMLProvider::findByName(const QString &fileName, QString *foundSuffix, int *weightPtr)
 {
     ensureLoaded();
 
-    const QStringList matchingMimeTypes = m_mimeTypeGlobs.matchingGlobs(fileName, foundSuffix);
+    bool fastPatternMatched = false;
+    const QStringList matchingMimeTypes = m_mimeTypeGlobs.matchingGlobs(fileName, foundSuffix, weightPtr, &fastPatternMatched, m_db->m_trace);
+    if (fastPatternMatched && m_db->countersEnabled())
+        ++m_db->m_counters.fastGlobHits;
     return matchingMimeTypes;
 }
 
 QMimeType QMimeXMLProvider::findByMagic(const QByteArray &data, int *accuracyPtr)
 {
-    ensureLoaded();
+    ensureMagicLoaded();
 
+    QMimeTraceStage stage(m_db->m_trace, "magic");
+    stage.addBytesExamined(data.size());
     QString candidate;
+    int evaluated = 0;
 
     foreach (const QMimeMagicRuleMatcher &matcher, m_magicMatchers) {
+        // Keeps the best candidate found so far
+        if (m_db->m_deadline && m_db->m_deadline->hasExpired())
+            break;
+        ++evaluated;
         if (matcher.matches(data)) {
             const int priority = matcher.priority();
+            if (stage.isActive())
+                stage.addCandidate(matcher.mimetype(), priority, QLatin1String("magic"));
             if (priority > *accuracyPtr) {
                 *accuracyPtr = priority;
                 candidate = matcher.mimetype();
             }
         }
     }
+    stage.addRulesTried(evaluated);
+    if (m_db->countersEnabled())
+        m_db->m_counters.magicMatchersEvaluated += evaluated;
     return mimeTypeForName(candidate);
 }
 
+QMimeType QMimeXMLProvider::findByMagicAmong(const QByteArray &data, int *accuracyPtr,
+                                             const QSet<QString> &mimeTypes)
+{
+    ensureMagicLoaded();
+
+    QMimeTraceStage stage(m_db->m_trace, "candidateMagic");
+    stage.addBytesExamined(data.size());
+
+    // In the same order as findByMagic(), for the same choice between equal priorities
+    QList<int> indexes;
+    foreach (const QString &mimeType, mimeTypes)
+        indexes += m_magicMatcherIndexes.value(mimeType);
+    std::sort(indexes.begin(), indexes.end());
+
+    QString candidate;
+    int evaluated = 0;
+    foreach (int i, indexes) {
+        if (m_db->m_deadline && m_db->m_deadline->hasExpired())
+            break;
+        ++evaluated;
+        const QMimeMagicRuleMatcher &matcher = m_magicMatchers.at(i);
+        if (matcher.matches(data)) {
+            const int priority = matcher.priority();
+            if (stage.isActive())
+                stage.addCandidate(matcher.mimetype(), priority, QLatin1String("magic"));
+            if (priority > *accuracyPtr) {
+                *accuracyPtr = priority;
+                candidate = matcher.mimetype();
+            }
+        }
+    }
+    stage.addRulesTried(evaluated);
+    if (m_db->countersEnabled())
+        m_db->m_counters.magicMatchersEvaluated += evaluated;
+    return mimeTypeForName(candidate);
+}
+
+int QMimeXMLProvider::magicMaxExtent()
+{
+    ensureMagicLoaded();
+    return m_magicMaxExtent;
+}
+
 void QMimeXMLProvider::ensureLoaded()
 {
     if (!m_loaded) {
         bool fdoXmlFound = false;
         QStringList allFiles;
 
-        const QStringList packageDirs = QStandardPaths::locateAll(QStandardPaths::GenericDataLocation, QLatin1String("mime/packages"), QStandardPaths::LocateDirectory);
+        const QStringList packageDirs = m_db->m_directoryCache.locateAllDirectories(QLatin1String("packages"));
         foreach (const QString &packageDir, packageDirs) {
             QDir dir(packageDir);
             const QStringList files = dir.entryList(QDir::Files | QDir::NoDotAndDotDot);
@@ -595,27 +925,51 @@ void QMimeXMLProvider::ensureLoaded()
         if (!fdoXmlFound) {
             // TODO: putting the xml file in the resource is a hack for now
             // We should instead install the file as part of installing Qt
-            load(QLatin1String(":/qmime/freedesktop.org.xml"));
+            allFiles.prepend(QLatin1String(":/qmime/freedesktop.org.xml"));
         }
 
-        foreach (const QString& file, allFiles)
-            load(file);
+        m_packageFiles = allFiles;
+        loadFiles(allFiles, BaseMimeTypeParser::MimeTypeContent);
+        m_loaded = true;
     }
 }
 
-void QMimeXMLProvider::load(const QString &fileName)
+void QMimeXMLProvider::ensureMagicLoaded()
 {
-    QString errorMessage;
-    if (!load(fileName, &errorMessage))
-        qWarning("QMimeDatabase: Error loading %s\n%s", qPrintable(fileName), qPrintable(errorMessage));
+    ensureLoaded();
+    if (!m_magicLoaded) {
+        loadFiles(m_packageFiles, BaseMimeTypeParser::MagicContent);
+        m_magicLoaded = true;
+    }
 }
 
-bool QMimeXMLProvider::load(const QString &fileName, QString *errorMessage)
+void QMimeXMLProvider::ensureCommentsLoaded()
+{
+    ensureLoaded();
+    if (!m_commentsLoaded) {
+        loadFiles(m_packageFiles, BaseMimeTypeParser::CommentContent);
+        m_commentsLoaded = true;
+    }
+}
+
+// Called by QMimeType::comment(), without the database mutex locked.
+// The glob patterns are set by the parser already, so only the comments are loaded on demand.
+void QMimeXMLProvider::loadComments(QMimeTypePrivate &data)
 {
-    m_loaded = true;
+    if (data.commentsLoaded)
+        return;
+    QMutexLocker locker(&m_db->mutex);
+    ensureCommentsLoaded();
+    if (data.localeComments.isEmpty())
+        data.localeComments = m_comments.value(data.name);
+    data.commentsLoaded = true;
+}
 
+// Opens fileName and feeds its contents to parser
+static bool parsePackageFile(const QString &fileName, BaseMimeTypeParser &parser, QString *errorMessage)
+{
     QFile file(fileName);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    if (!file.open(QIODevice::ReadOnly)) {
         if (errorMessage)
             *errorMessage = QString::fromLatin1("Cannot open %1: %2").arg(fileName, file.errorString());
         return false;
@@ -624,18 +978,351 @@ bool QMimeXMLProvider::load(const QString &fileName, QString *errorMessage)
     if (errorMessage)
         errorMessage->clear();
 
-    MimeTypeParser parser(*this);
+    // Parse the mapped file directly; compressed resources can't be mapped, read them instead.
+    QByteArray contents;
+    const uchar *mapped = file.map(0, file.size());
+    if (!mapped)
+        contents = file.readAll();
+    const char *data = mapped ? reinterpret_cast<const char *>(mapped) : contents.constData();
+    const int size = mapped ? int(file.size()) : contents.size();
+    switch (parser.parseFast(data, size, fileName, errorMessage)) {
+    case BaseMimeTypeParser::FastParseSucceeded:
+        return true;
+    case BaseMimeTypeParser::FastParseFailed:
+        return false;
+    case BaseMimeTypeParser::FastParseUnsupported:
+        break;
+    }
+
+    // Not UTF-8, or declares entities: use QXmlStreamReader
+    file.seek(0);
     return parser.parse(&file, fileName, errorMessage);
 }
 
+namespace {
+
+// What one package file contains, recorded in the order the parser reported it,
+// so that the file can be parsed without touching the provider.
+class PackageContents : public BaseMimeTypeParser
+{
+public:
+    PackageContents(const QString &fileName, int flags, const QSet<QString> &locales)
+        : m_fileName(fileName), m_ok(false)
+    {
+        setContents(flags);
+        setCommentLocales(locales);
+    }
+
+    void load() { m_ok = parsePackageFile(m_fileName, *this, &m_errorMessage); }
+
+    void addTo(QMimeXMLProvider &provider) const
+    {
+        // Whatever was parsed before an error is kept, like when parsing into the provider directly
+        for (int i = 0; i < m_mimeTypes.size(); ++i)
+            provider.addMimeType(m_mimeTypes.at(i));
+        for (int i = 0; i < m_globs.size(); ++i)
+            provider.addGlobPattern(m_globs.at(i));
+        for (int i = 0; i < m_parents.size(); ++i)
+            provider.addParent(m_parents.at(i).first, m_parents.at(i).second);
+        for (int i = 0; i < m_aliases.size(); ++i)
+            provider.addAlias(m_aliases.at(i).first, m_aliases.at(i).second);
+        for (int i = 0; i < m_magicMatchers.size(); ++i)
+            provider.addMagicMatcher(m_magicMatchers.at(i));
+        for (int i = 0; i < m_comments.size(); ++i)
+            provider.addComments(m_comments.at(i).first, m_comments.at(i).second);
+        if (!m_ok)
+            qWarning("QMimeDatabase: Error loading %s\n%s", qPrintable(m_fileName), qPrintable(m_errorMessage));
+    }
+
+protected:
+    bool process(const QMimeType &t, QString *)
+    { m_mimeTypes.append(t); return true; }
+
+    bool process(const QMimeGlobPattern &glob, QString *)
+    { m_globs.append(glob); return true; }
+
+    void processParent(const QString &child, const QString &parent)
+    { m_parents.append(qMakePair(child, parent)); }
+
+    void processAlias(const QString &alias, const QString &name)
+    { m_aliases.append(qMakePair(alias, name)); }
+
+    void processMagicMatcher(const QMimeMagicRuleMatcher &matcher)
+    { m_magicMatchers.append(matcher); }
+
+    void processComments(const QString &name, const QHash<QString, QString> &localeComments)
+    { m_comments.append(qMakePair(name, localeComments)); }
+
+private:
+    const QString m_fileName;
+    bool m_ok;
+    QString m_errorMessage;
+    QList<QMimeType> m_mimeTypes;
+    QList<QMimeGlobPattern> m_globs;
+    QList<QPair<QString, QString> > m_parents;
+    QList<QPair<QString, QString> > m_aliases;
+    QList<QMimeMagicRuleMatcher> m_magicMatchers;
+    QList<QPair<QString, QHash<QString, QString> > > m_comments;
+};
+
+// Takes the next file which nobody is parsing yet, until there are none left
+class PackageLoader : public QRunnable
+{
+public:
+    PackageLoader(const QVector<PackageContents *> &packages, QAtomicInt &nextPackage)
+        : m_packages(packages), m_nextPackage(nextPackage) {}
+
+    void run()
+    {
+        for (;;) {
+            const int i = m_nextPackage.fetchAndAddOrdered(1);
+            if (i >= m_packages.size())
+                return;
+            m_packages.at(i)->load();
+        }
+    }
+
+private:
+    const QVector<PackageContents *> &m_packages;
+    QAtomicInt &m_nextPackage;
+};
+
+} // namespace
+
+/*!
+    Loads the package files \a fileNames completely, later files overriding earlier ones.
+ */
+void QMimeXMLProvider::loadFiles(const QStringList &fileNames)
+{
+    m_loaded = m_magicLoaded = m_commentsLoaded = true;
+    m_packageFiles += fileNames;
+    loadFiles(fileNames, BaseMimeTypeParser::AllContent);
+}
+
+/*!
+    Loads the parts \a contents (BaseMimeTypeParser::Content flags) of the package files \a fileNames.
+
+    The files are parsed in parallel when there are several of them and more than
+    one core, then added to the provider in the order of \a fileNames, so the result
+    is the same as loading each file in turn.
+ */
+void QMimeXMLProvider::loadFiles(const QStringList &fileNames, int contents)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const int threadCount = qMin(QThread::idealThreadCount(), fileNames.count());
+    if (threadCount <= 1) {
+        foreach (const QString &file, fileNames)
+            load(file, contents);
+        m_loadTime += timer.elapsed();
+        return;
+    }
+
+    QVector<PackageContents *> packages;
+    packages.reserve(fileNames.count());
+    foreach (const QString &file, fileNames)
+        packages.append(new PackageContents(file, contents, m_db->retainedLocaleSet()));
+
+    // The calling thread takes part too, the pool only provides the additional threads.
+    // A private pool, so that this can't be starved by (or starve) the application's tasks.
+    QAtomicInt nextPackage(0);
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount - 1);
+    for (int i = 0; i < threadCount - 1; ++i)
+        pool.start(new PackageLoader(packages, nextPackage));
+    PackageLoader(packages, nextPackage).run();
+    pool.waitForDone();
+
+    foreach (PackageContents *package, packages)
+        package->addTo(*this);
+    qDeleteAll(packages);
+    m_loadTime += timer.elapsed();
+}
+
+void QMimeXMLProvider::load(const QString &fileName, int contents)
+{
+    QString errorMessage;
+    MimeTypeParser parser(*this);
+    parser.setContents(contents);
+    parser.setCommentLocales(m_db->retainedLocaleSet());
+    if (!parsePackageFile(fileName, parser, &errorMessage))
+        qWarning("QMimeDatabase: Error loading %s\n%s", qPrintable(fileName), qPrintable(errorMessage));
+}
+
+bool QMimeXMLProvider::load(const QString &fileName, QString *errorMessage)
+{
+    m_loaded = m_magicLoaded = m_commentsLoaded = true;
+    m_packageFiles.append(fileName);
+
+    QElapsedTimer timer;
+    timer.start();
+    MimeTypeParser parser(*this);
+    parser.setCommentLocales(m_db->retainedLocaleSet());
+    const bool ok = parsePackageFile(fileName, parser, errorMessage);
+    m_loadTime += timer.elapsed();
+    return ok;
+}
+
+namespace {
+
+// Collects the comments of all types in one language
+class LocaleCommentParser : public BaseMimeTypeParser
+{
+public:
+    explicit LocaleCommentParser(const QString &locale) : m_locale(locale)
+    {
+        setContents(CommentContent);
+        setCommentLocales(QSet<QString>() << locale);
+    }
+
+    QHash<QString, QString> comments() const { return m_comments; }
+
+protected:
+    bool process(const QMimeType &, QString *) { return true; }
+    bool process(const QMimeGlobPattern &, QString *) { return true; }
+    void processParent(const QString &, const QString &) {}
+    void processAlias(const QString &, const QString &) {}
+    void processMagicMatcher(const QMimeMagicRuleMatcher &) {}
+
+    void processComments(const QString &name, const QHash<QString, QString> &localeComments)
+    {
+        // A later definition of the type replaces the earlier one, comments included
+        const QString comment = localeComments.value(m_locale);
+        if (comment.isEmpty())
+            m_comments.remove(name);
+        else
+            m_comments.insert(name, comment);
+    }
+
+private:
+    const QString m_locale;
+    QHash<QString, QString> m_comments; // type name -> comment
+};
+
+} // namespace
+
+// Called by QMimeType, without the database mutex locked.
+// Each language is read from the files once, for all types.
+QString QMimeXMLProvider::loadComment(const QMimeTypePrivate &data, const QString &locale)
+{
+    QMutexLocker locker(&m_db->mutex);
+    ensureLoaded();
+    CommentsHash::const_iterator it = m_otherLocaleComments.constFind(locale);
+    if (it == m_otherLocaleComments.constEnd()) {
+        QElapsedTimer timer;
+        timer.start();
+        LocaleCommentParser parser(locale);
+        foreach (const QString &file, m_packageFiles) {
+            QString errorMessage; // already reported when loading the types
+            parsePackageFile(file, parser, &errorMessage);
+        }
+        it = m_otherLocaleComments.insert(locale, parser.comments());
+        m_loadTime += timer.elapsed();
+    }
+    return it.value().value(data.name);
+}
+
+/*!
+    Returns the copy of \a str held by the pool, adding \a str if there is none yet.
+ */
+QString QMimeStringPool::intern(const QString &str)
+{
+    QSet<QString>::const_iterator it = m_strings.constFind(str);
+    if (it != m_strings.constEnd())
+        return *it;
+    m_strings.insert(str);
+    return str;
+}
+
+qint64 QMimeStringPool::memoryUsage() const
+{
+    qint64 size = 0;
+    foreach (const QString &str, m_strings)
+        size += HashNodeOverhead + sizeof(QString) + stringDataSize(str);
+    return size;
+}
+
+void QMimeXMLProvider::addStatistics(QMimeDatabaseStatistics &stats)
+{
+    stats.provider = QLatin1String("xml");
+    stats.mimeTypeCount = m_nameMimeTypeMap.count();
+    stats.magicMatcherCount = m_magicMatchers.count();
+    const int globListCount = m_mimeTypeGlobs.m_highWeightGlobs.count() + m_mimeTypeGlobs.m_lowWeightGlobs.count();
+    stats.globPatternCount = globListCount;
+
+    // All the names, patterns, icon names and comment languages are in the pool,
+    // the containers only hold references to them.
+    qint64 size = m_strings.memoryUsage();
+
+    NameMimeTypeMap::const_iterator typeIt = m_nameMimeTypeMap.constBegin();
+    for ( ; typeIt != m_nameMimeTypeMap.constEnd(); ++typeIt) {
+        const QMimeTypePrivate data(typeIt.value());
+        size += HashNodeOverhead + sizeof(QString) + sizeof(QMimeType) + sizeof(QMimeTypePrivate);
+        size += data.globPatterns.count() * ListNodeSize;
+        if (!m_comments.contains(data.name)) // otherwise shared with m_comments
+            size += commentsSize(data.localeComments);
+    }
+    CommentsHash::const_iterator commentsIt = m_comments.constBegin();
+    for ( ; commentsIt != m_comments.constEnd(); ++commentsIt)
+        size += HashNodeOverhead + sizeof(QString) + sizeof(QHash<QString, QString>) + commentsSize(commentsIt.value());
+
+    QMimeAllGlobPatterns::PatternsMap::const_iterator globIt = m_mimeTypeGlobs.m_fastPatterns.constBegin();
+    for ( ; globIt != m_mimeTypeGlobs.m_fastPatterns.constEnd(); ++globIt) {
+        stats.globPatternCount += globIt.value().count();
+        size += HashNodeOverhead + sizeof(QString) + sizeof(QStringList) + stringDataSize(globIt.key());
+        size += globIt.value().count() * ListNodeSize;
+    }
+    size += globListCount * (ListNodeSize + sizeof(QMimeGlobPattern));
+
+    ParentsHash::const_iterator parentIt = m_parents.constBegin();
+    for ( ; parentIt != m_parents.constEnd(); ++parentIt)
+        size += HashNodeOverhead + sizeof(QString) + sizeof(QStringList) + parentIt.value().count() * ListNodeSize;
+    size += m_aliases.count() * (HashNodeOverhead + 2 * sizeof(QString));
+
+    foreach (const QMimeMagicRuleMatcher &matcher, m_magicMatchers)
+        size += ListNodeSize + sizeof(QMimeMagicRuleMatcher) + magicRulesSize(matcher.magicRules());
+    stats.heapBytes += size;
+
+    qint64 cacheSize = (m_mimetypeNames.count() + m_allMimeTypes.count()) * ListNodeSize;
+    CommentsHash::const_iterator localeIt = m_otherLocaleComments.constBegin();
+    for ( ; localeIt != m_otherLocaleComments.constEnd(); ++localeIt) {
+        cacheSize += HashNodeOverhead + sizeof(QString) + sizeof(QHash<QString, QString>);
+        cacheSize += commentsSize(localeIt.value());
+    }
+    stats.cacheBytes += cacheSize;
+    stats.loadTime += m_loadTime;
+}
+
+QHash<QString, QString> QMimeXMLProvider::internComments(const QHash<QString, QString> &localeComments)
+{
+    QHash<QString, QString> result;
+    QHash<QString, QString>::const_iterator it = localeComments.constBegin();
+    for ( ; it != localeComments.constEnd(); ++it)
+        result.insert(m_strings.intern(it.key()), it.value());
+    return result;
+}
+
 void QMimeXMLProvider::addGlobPattern(const QMimeGlobPattern& glob)
 {
-    m_mimeTypeGlobs.addGlob(glob);
+    m_mimeTypeGlobs.addGlob(QMimeGlobPattern(m_strings.intern(glob.pattern()), m_strings.intern(glob.mimeType()),
+                                             glob.weight(), glob.isCaseSensitive() ? Qt::CaseSensitive : Qt::CaseInsensitive));
 }
 
 void QMimeXMLProvider::addMimeType(const QMimeType &mt)
 {
-    m_nameMimeTypeMap.insert(mt.name(), mt);
+    QMimeTypePrivate data(mt);
+    data.name = m_strings.intern(data.name);
+    data.genericIconName = m_strings.intern(data.genericIconName);
+    data.iconName = m_strings.intern(data.iconName);
+    for (int i = 0; i < data.globPatterns.size(); ++i)
+        data.globPatterns[i] = m_strings.intern(data.globPatterns.at(i));
+    if (!data.localeComments.isEmpty())
+        data.localeComments = internComments(data.localeComments);
+
+    m_nameMimeTypeMap.insert(data.name, QMimeType(data));
+    m_mimetypeNames.clear();
+    m_allMimeTypes.clear();
 }
 
 QStringList QMimeXMLProvider::parents(const QString &mime)
@@ -651,7 +1338,7 @@ QStringList QMimeXMLProvider::parents(const QString &mime)
 
 void QMimeXMLProvider::addParent(const QString &child, const QString &parent)
 {
-    m_parents[child].append(parent);
+    m_parents[m_strings.intern(child)].append(m_strings.intern(parent));
 }
 
 QString QMimeXMLProvider::resolveAlias(const QString &name)
@@ -661,15 +1348,58 @@ QString QMimeXMLProvider::resolveAlias(const QString &name)
 
 void QMimeXMLProvider::addAlias(const QString &alias, const QString &name)
 {
-    m_aliases.insert(alias, name);
+    m_aliases.insert(m_strings.intern(alias), m_strings.intern(name));
 }
 
 QList<QMimeType> QMimeXMLProvider::allMimeTypes()
 {
-    return m_nameMimeTypeMap.values();
+    if (m_allMimeTypes.isEmpty()) {
+        const QStringList names = allMimeTypeNames();
+        m_allMimeTypes.reserve(names.count());
+        foreach (const QString &name, names)
+            m_allMimeTypes.append(m_nameMimeTypeMap.value(name));
+    }
+    return m_allMimeTypes;
+}
+
+QStringList QMimeXMLProvider::allMimeTypeNames()
+{
+    ensureLoaded();
+
+    if (m_mimetypeNames.isEmpty()) {
+        m_mimetypeNames = m_nameMimeTypeMap.keys();
+        m_mimetypeNames.sort();
+    }
+    return m_mimetypeNames;
+}
+
+QStringList QMimeXMLProvider::allGlobPatterns()
+{
+    ensureLoaded();
+
+    QStringList patterns;
+    QMimeAllGlobPatterns::PatternsMap::const_iterator it = m_mimeTypeGlobs.m_fastPatterns.constBegin();
+    for ( ; it != m_mimeTypeGlobs.m_fastPatterns.constEnd(); ++it)
+        patterns.append(QLatin1String("*.") + it.key());
+    foreach (const QMimeGlobPattern &glob, m_mimeTypeGlobs.m_highWeightGlobs)
+        patterns.append(glob.pattern());
+    foreach (const QMimeGlobPattern &glob, m_mimeTypeGlobs.m_lowWeightGlobs)
+        patterns.append(glob.pattern());
+    return patterns;
 }
 
 void QMimeXMLProvider::addMagicMatcher(const QMimeMagicRuleMatcher &matcher)
 {
-    m_magicMatchers.append(matcher);
+    QMimeMagicRuleMatcher internedMatcher(m_strings.intern(matcher.mimetype()), matcher.priority());
+    const QList<QMimeMagicRule> rules = matcher.magicRules();
+    internedMatcher.addRules(rules);
+    m_magicMatcherIndexes[internedMatcher.mimetype()].append(m_magicMatchers.count());
+    m_magicMatchers.append(internedMatcher);
+    foreach (const QMimeMagicRule &rule, rules)
+        m_magicMaxExtent = qMax(m_magicMaxExtent, rule.extent());
+}
+
+void QMimeXMLProvider::addComments(const QString &name, const QHash<QString, QString> &localeComments)
+{
+    m_comments.insert(m_strings.intern(name), internComments(localeComments));
 }
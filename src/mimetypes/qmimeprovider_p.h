@@ -24,7 +24,7 @@
 #include "qmimedatabase_p.h"
 class QMimeMagicRuleMatcher;
 
-class QMimeProviderBase
+class QMIME_EXPORT QMimeProviderBase
 {
 public:
     QMimeProviderBase(QMimeDatabasePrivate *db);
@@ -32,22 +32,38 @@ public:
 
     virtual bool isValid() = 0;
     virtual QMimeType mimeTypeForName(const QString &name) = 0;
-    virtual QStringList findByName(const QString &fileName, QString *foundSuffix) = 0;
+    // Also returns the weight of the matching globs, in weightPtr
+    virtual QStringList findByName(const QString &fileName, QString *foundSuffix, int *weightPtr) = 0;
     virtual QStringList parents(const QString &mime) = 0;
     virtual QString resolveAlias(const QString &name) = 0;
     virtual QMimeType findByMagic(const QByteArray &data, int *accuracyPtr) = 0;
+    // Only evaluates the magic of the given types
+    virtual QMimeType findByMagicAmong(const QByteArray &data, int *accuracyPtr,
+                                       const QSet<QString> &mimeTypes) = 0;
+    // How many bytes of data findByMagic() can look at, 0 if unknown
+    virtual int magicMaxExtent() = 0;
     virtual QList<QMimeType> allMimeTypes() = 0;
+    virtual QStringList allMimeTypeNames() = 0;
+    // For QMimeNameCache
+    virtual QStringList allGlobPatterns() = 0;
     virtual void loadMimeTypePrivate(QMimeTypePrivate &) {}
+    // Only called by QMimeType::comment()
+    virtual void loadComments(QMimeTypePrivate &data) { loadMimeTypePrivate(data); }
     virtual void loadIcon(QMimeTypePrivate &) {}
     virtual void loadGenericIcon(QMimeTypePrivate &) {}
+    // The comment in a language which isn't retained by loadComments()
+    virtual QString loadComment(const QMimeTypePrivate &, const QString &) { return QString(); }
+    // Only reports what is loaded already
+    virtual void addStatistics(QMimeDatabaseStatistics &stats) = 0;
 
     QMimeDatabasePrivate* m_db;
+    qint64 m_loadTime; // milliseconds
 };
 
 /*
    Parses mime.cache on demand
  */
-class QMimeBinaryProvider : public QMimeProviderBase
+class QMIME_EXPORT QMimeBinaryProvider : public QMimeProviderBase
 {
 public:
     QMimeBinaryProvider(QMimeDatabasePrivate *db);
@@ -55,43 +71,97 @@ public:
 
     virtual bool isValid();
     virtual QMimeType mimeTypeForName(const QString &name);
-    virtual QStringList findByName(const QString &fileName, QString *foundSuffix);
+    virtual QStringList findByName(const QString &fileName, QString *foundSuffix, int *weightPtr);
     virtual QStringList parents(const QString &mime);
     virtual QString resolveAlias(const QString &name);
     virtual QMimeType findByMagic(const QByteArray &data, int *accuracyPtr);
+    virtual QMimeType findByMagicAmong(const QByteArray &data, int *accuracyPtr,
+                                       const QSet<QString> &mimeTypes);
+    virtual int magicMaxExtent();
     virtual QList<QMimeType> allMimeTypes();
+    virtual QStringList allMimeTypeNames();
+    virtual QStringList allGlobPatterns();
     virtual void loadMimeTypePrivate(QMimeTypePrivate &);
     virtual void loadIcon(QMimeTypePrivate &);
     virtual void loadGenericIcon(QMimeTypePrivate &);
+    virtual QString loadComment(const QMimeTypePrivate &data, const QString &locale);
+    virtual void addStatistics(QMimeDatabaseStatistics &stats);
 
 private:
     struct CacheFile;
 
-    void matchGlobList(QMimeGlobMatchResult &result, CacheFile *cacheFile, int offset, const QString &fileName);
-    bool matchSuffixTree(QMimeGlobMatchResult &result, CacheFile *cacheFile, int numEntries, int firstOffset, const QString &fileName, int charPos, bool caseSensitiveCheck);
+    void checkMimeTypeList();
+
+    void matchGlobList(QMimeGlobMatchResult &result, CacheFile *cacheFile, int offset, const QString &fileName, QMimeTraceStage &stage);
+    bool matchSuffixTree(QMimeGlobMatchResult &result, CacheFile *cacheFile, int numEntries, int firstOffset, const QString &fileName, int charPos, bool caseSensitiveCheck, QMimeTraceStage &stage);
     bool matchMagicRule(CacheFile *cacheFile, int numMatchlets, int firstOffset, const QByteArray &data);
+    QMimeType matchMagicAt(CacheFile *cacheFile, int off, const QByteArray &data, int *accuracyPtr,
+                           QMimeTraceStage &stage);
     QString iconForMime(CacheFile *cacheFile, int posListOffset, const QByteArray& inputMime);
+    int suffixTreeLeafCount(CacheFile *cacheFile, int numEntries, int firstOffset);
+    void addGlobListPatterns(CacheFile *cacheFile, int offset, QStringList *patterns);
+    void addSuffixTreePatterns(CacheFile *cacheFile, int numEntries, int firstOffset, const QString &suffix,
+                               QStringList *patterns);
 
     QList<CacheFile *> m_cacheFiles;
+
+    // Read from the "types" files, sorted, and reloaded when the directories change
+    bool m_mimetypeListLoaded;
+    int m_mimetypeListGeneration;
+    QStringList m_mimetypeNames;
+    QList<QMimeType> m_allMimeTypes;
+
+    // Type name -> locale -> comment, for the locales which aren't retained,
+    // read when asked for and dropped when the directories change
+    QHash<QString, QHash<QString, QString> > m_otherLocaleComments;
+    int m_otherLocaleCommentsGeneration;
+};
+
+/*
+   Keeps a single copy of equal strings. The type names are repeated in the globs,
+   parents, aliases and magic matchers, and the same few icon names and comment
+   languages are used by hundreds of types.
+ */
+class QMimeStringPool
+{
+public:
+    QString intern(const QString &str);
+    int count() const { return m_strings.count(); }
+    qint64 memoryUsage() const;
+
+private:
+    QSet<QString> m_strings;
 };
 
 /*
    Parses the raw XML files (slower)
  */
-class QMimeXMLProvider : public QMimeProviderBase
+class QMIME_EXPORT QMimeXMLProvider : public QMimeProviderBase
 {
 public:
     QMimeXMLProvider(QMimeDatabasePrivate *db);
 
     virtual bool isValid();
     virtual QMimeType mimeTypeForName(const QString &name);
-    virtual QStringList findByName(const QString &fileName, QString *foundSuffix);
+    virtual QStringList findByName(const QString &fileName, QString *foundSuffix, int *weightPtr);
     virtual QStringList parents(const QString &mime);
     virtual QString resolveAlias(const QString &name);
     virtual QMimeType findByMagic(const QByteArray &data, int *accuracyPtr);
+    virtual QMimeType findByMagicAmong(const QByteArray &data, int *accuracyPtr,
+                                       const QSet<QString> &mimeTypes);
+    virtual int magicMaxExtent();
     virtual QList<QMimeType> allMimeTypes();
+    virtual QStringList allMimeTypeNames();
+    virtual QStringList allGlobPatterns();
+    virtual void loadComments(QMimeTypePrivate &data);
+    virtual QString loadComment(const QMimeTypePrivate &data, const QString &locale);
+    virtual void addStatistics(QMimeDatabaseStatistics &stats);
+
+    // Whether the comments were read from the package files, for the tests
+    bool commentsLoaded() const { return m_commentsLoaded; }
 
     bool load(const QString &fileName, QString *errorMessage);
+    void loadFiles(const QStringList &fileNames);
 
     // Called by the mimetype xml parser
     void addMimeType(const QMimeType &mt);
@@ -99,12 +169,21 @@ public:
     void addParent(const QString &child, const QString &parent);
     void addAlias(const QString &alias, const QString &name);
     void addMagicMatcher(const QMimeMagicRuleMatcher &matcher);
+    void addComments(const QString &name, const QHash<QString, QString> &localeComments);
 
 private:
     void ensureLoaded();
-    void load(const QString &fileName);
+    void ensureMagicLoaded();
+    void ensureCommentsLoaded();
+    void loadFiles(const QStringList &fileNames, int contents);
+    void load(const QString &fileName, int contents);
 
+    // The files are read in separate passes, for the parts which are needed:
+    // the types and globs first, the magic and the comments only when asked for.
     bool m_loaded;
+    bool m_magicLoaded;
+    bool m_commentsLoaded;
+    QStringList m_packageFiles;
 
     typedef QHash<QString, QMimeType> NameMimeTypeMap;
     NameMimeTypeMap m_nameMimeTypeMap;
@@ -117,6 +196,20 @@ private:
     QMimeAllGlobPatterns m_mimeTypeGlobs;
 
     QList<QMimeMagicRuleMatcher> m_magicMatchers;
+    QHash<QString, QList<int> > m_magicMatcherIndexes; // type name -> indexes in m_magicMatchers
+    int m_magicMaxExtent;
+
+    QHash<QString, QString> internComments(const QHash<QString, QString> &localeComments);
+
+    QMimeStringPool m_strings;
+
+    typedef QHash<QString, QHash<QString, QString> > CommentsHash;
+    CommentsHash m_comments; // type name -> retained locale -> comment
+    CommentsHash m_otherLocaleComments; // locale -> type name -> comment, read when asked for
+
+    // Sorted, built on first use
+    QStringList m_mimetypeNames;
+    QList<QMimeType> m_allMimeTypes;
 };
 
 #endif // QMIMEPROVIDER_P_H
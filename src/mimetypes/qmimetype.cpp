@@ -40,6 +40,7 @@ bool isQMimeTypeDebuggingActivated (false);
 #endif
 
 QMimeTypePrivate::QMimeTypePrivate()
+    : commentsLoaded(false)
 {}
 
 QMimeTypePrivate::QMimeTypePrivate(const QMimeType &other)
@@ -49,6 +50,7 @@ QMimeTypePrivate::QMimeTypePrivate(const QMimeType &other)
         , genericIconName(other.d->genericIconName)
         , iconName(other.d->iconName)
         , globPatterns(other.d->globPatterns)
+        , commentsLoaded(other.d->commentsLoaded)
 {}
 
 void QMimeTypePrivate::clear()
@@ -59,6 +61,7 @@ void QMimeTypePrivate::clear()
     genericIconName.clear();
     iconName.clear();
     globPatterns.clear();
+    commentsLoaded = false;
 }
 
 /*!
@@ -287,6 +290,15 @@ QStringList QMimeType::aliases() const
 }
 #endif
 
+// The comments in the languages which aren't retained aren't in localeComments
+static QString localeComment(QMimeProviderBase *provider, const QMimeTypePrivate &d, const QString &locale)
+{
+    const QString comm = d.localeComments.value(locale);
+    if (!comm.isEmpty() || QMimeDatabasePrivate::instance()->isRetainedLocale(locale))
+        return comm;
+    return provider->loadComment(d, locale);
+}
+
 /*!
     \fn QString QMimeType::comment(const QString& localeName) const;
     \brief Returns the description of the MIME type to be displayed on user interfaces.
@@ -296,7 +308,8 @@ QStringList QMimeType::aliases() const
  */
 QString QMimeType::comment(const QString& localeName) const
 {
-    QMimeDatabasePrivate::instance()->provider()->loadMimeTypePrivate(*d);
+    QMimeProviderBase *provider = QMimeDatabasePrivate::instance()->provider();
+    provider->loadComments(*d);
 
     QStringList languageList;
     if (!localeName.isEmpty())
@@ -304,14 +317,14 @@ QString QMimeType::comment(const QString& localeName) const
     languageList << QLocale::system().name();
     languageList << QLocale::system().uiLanguages();
     Q_FOREACH(const QString& lang, languageList) {
-        const QString comm = d->localeComments.value(lang);
+        const QString comm = localeComment(provider, *d, lang);
         if (!comm.isEmpty())
             return comm;
         const int pos = lang.indexOf(QLatin1Char('_'));
         if (pos != -1) {
             // "pt_BR" not found? try just "pt"
             const QString shortLang = lang.left(pos);
-            const QString commShort = d->localeComments.value(shortLang);
+            const QString commShort = localeComment(provider, *d, shortLang);
             if (!commShort.isEmpty())
                 return commShort;
         }
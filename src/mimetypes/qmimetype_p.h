@@ -50,6 +50,7 @@ struct QMIME_EXPORT QMimeTypePrivate : public QSharedData
     QString genericIconName;
     QString iconName;
     QStringList globPatterns;
+    bool commentsLoaded; // by QMimeProviderBase::loadComments(), not compared
 };
 
 QT_END_NAMESPACE
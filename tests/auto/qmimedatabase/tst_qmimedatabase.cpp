@@ -7,13 +7,23 @@
 #include "tst_qmimedatabase.h"
 
 #include <qmimedatabase.h>
+#include <qmimedirectoryscanner.h>
+#include <qmimefileindex.h>
+#include "qmimeprovider_p.h"
 
 #include "qstandardpaths.h"
 
+#include <QtCore/QBuffer>
+#include <QtCore/QDirIterator>
 #include <QtCore/QFile>
+#include <QtCore/QMutex>
 
 #include <QtTest/QtTest>
 
+#ifdef Q_OS_LINUX
+#include <sys/xattr.h>
+#endif
+
 #if 0
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 0, 0))
 #include <QtWidgets/QIcon>
@@ -78,6 +88,23 @@ void tst_qmimedatabase::test_mimeTypeForName()
 
 }
 
+void tst_qmimedatabase::test_retainedLocales()
+{
+    QMimeDatabase db;
+    const QStringList oldLocales = db.retainedLocales();
+    QVERIFY(oldLocales.contains(QString::fromLatin1("en_US")));
+
+    db.setRetainedLocales(QStringList() << QString::fromLatin1("en_US") << QString::fromLatin1("de"));
+    QCOMPARE(db.retainedLocales(), QStringList() << QString::fromLatin1("de") << QString::fromLatin1("en_US"));
+
+    // Not retained: read from the files once, then from the provider
+    const QMimeType mime = db.mimeTypeForName(QString::fromLatin1("application/x-zerosize"));
+    QCOMPARE(mime.comment(QLatin1String("fr")), QString::fromLatin1("document vide"));
+    QCOMPARE(mime.comment(QLatin1String("fr")), QString::fromLatin1("document vide"));
+
+    db.setRetainedLocales(oldLocales);
+}
+
 void tst_qmimedatabase::test_findByName_data()
 {
     QTest::addColumn<QString>("fileName");
@@ -282,6 +309,249 @@ void tst_qmimedatabase::test_findByUrl()
     QCOMPARE(db.findByUrl(QUrl::fromEncoded("ftp://foo/bar")).name(), QString::fromLatin1("application/octet-stream")); // unknown extension
 }
 
+void tst_qmimedatabase::test_lookupOptions()
+{
+    QMimeDatabase db;
+    QTemporaryFile tempFile(QDir::currentPath() + QLatin1String("/tst_qmimedatabase_XXXXXX"));
+    QVERIFY(tempFile.open());
+    const QString tempFileName = tempFile.fileName();
+    tempFile.write("%PDF-");
+    tempFile.close();
+
+    QMimeLookupOptions options;
+    QCOMPARE(db.findByFile(tempFileName, options).name(), QString::fromLatin1("application/pdf"));
+    options.maxBytesRead = 3;
+    QVERIFY(db.findByFile(tempFileName, options).name() != QLatin1String("application/pdf"));
+    options = QMimeLookupOptions();
+    options.readContent = false;
+    QVERIFY(db.findByFile(tempFileName, options).isDefault());
+    QFile file(tempFileName);
+    QVERIFY(db.findByData(&file, options).isDefault());
+
+    // The extension wins over the contents, unless its weight isn't trusted
+    QTemporaryFile txtTempFile(QDir::currentPath() + QLatin1String("/tst_qmimedatabase_XXXXXX.txt"));
+    QVERIFY(txtTempFile.open());
+    const QString txtTempFileName = txtTempFile.fileName();
+    txtTempFile.write("%PDF-");
+    txtTempFile.close();
+    options = QMimeLookupOptions();
+    QCOMPARE(db.findByFile(txtTempFileName, options).name(), QString::fromLatin1("text/plain"));
+    options.conclusiveGlobWeight = 51;
+    QCOMPARE(db.findByFile(txtTempFileName, options).name(), QString::fromLatin1("application/pdf"));
+    options.readContent = false;
+    QCOMPARE(db.findByFile(txtTempFileName, options).name(), QString::fromLatin1("text/plain"));
+
+#ifdef Q_OS_UNIX
+    const QString linkName = tempFileName + QLatin1String(".link");
+    QVERIFY(QFile::link(tempFileName, linkName));
+    options = QMimeLookupOptions();
+    QCOMPARE(db.findByFile(linkName, options).name(), QString::fromLatin1("application/pdf"));
+    options.followSymlinks = false;
+    QCOMPARE(db.findByFile(linkName, options).name(), QString::fromLatin1("inode/symlink"));
+    QFile::remove(linkName);
+#endif
+}
+
+// A sequential device which hands out its data only once
+class StreamDevice : public QIODevice
+{
+public:
+    explicit StreamDevice(const QByteArray &data) : m_data(data) {}
+    bool isSequential() const { return true; }
+    qint64 bytesAvailable() const { return m_data.size() + QIODevice::bytesAvailable(); }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize)
+    {
+        const int size = int(qMin(maxSize, qint64(m_data.size())));
+        memcpy(data, m_data.constData(), size);
+        m_data.remove(0, size);
+        return size;
+    }
+    qint64 writeData(const char *, qint64) { return -1; }
+
+private:
+    QByteArray m_data;
+};
+
+void tst_qmimedatabase::test_findByDeviceKeepsData()
+{
+    QMimeDatabase db;
+    const QByteArray data("%PDF-1.4 foo");
+
+    QBuffer buffer;
+    buffer.setData(data);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QVERIFY(buffer.seek(0));
+    QCOMPARE(db.findByData(&buffer).name(), QString::fromLatin1("application/pdf"));
+    QCOMPARE(buffer.pos(), qint64(0));
+    QCOMPARE(buffer.readAll(), data);
+
+    StreamDevice stream(data);
+    QVERIFY(stream.open(QIODevice::ReadOnly));
+    QCOMPARE(db.findByNameAndData(QString::fromLatin1("foo"), &stream).name(), QString::fromLatin1("application/pdf"));
+    QCOMPARE(db.findByData(&stream).name(), QString::fromLatin1("application/pdf"));
+    QCOMPARE(stream.readAll(), data);
+}
+
+// A sequential device whose data never arrives
+// Delivers \a data, then nothing more until the caller gives up waiting
+class StalledDevice : public QIODevice
+{
+public:
+    explicit StalledDevice(const QByteArray &data = QByteArray()) : m_data(data) {}
+
+    bool isSequential() const { return true; }
+    bool waitForReadyRead(int msecs) { QTest::qSleep(msecs + 1); return false; }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize)
+    {
+        const int size = int(qMin(maxSize, qint64(m_data.size())));
+        memcpy(data, m_data.constData(), size);
+        m_data.remove(0, size);
+        return size;
+    }
+    qint64 writeData(const char *, qint64) { return -1; }
+
+private:
+    QByteArray m_data;
+};
+
+void tst_qmimedatabase::test_findWithDeadline()
+{
+    QMimeDatabase db;
+    bool provisional = true;
+    QCOMPARE(db.findByFile(QString::fromLatin1(SRCDIR "testfiles/README.pdf"), -1, &provisional).name(),
+             QString::fromLatin1("application/pdf"));
+    QVERIFY(!provisional);
+
+    // The extension is enough, the device isn't read
+    StalledDevice device;
+    QVERIFY(device.open(QIODevice::ReadOnly));
+    QCOMPARE(db.findByNameAndData(QString::fromLatin1("foo.png"), &device, 10, &provisional).name(),
+             QString::fromLatin1("image/png"));
+    QVERIFY(!provisional);
+
+    // Neither an empty file, nor a complete result
+    QVERIFY(db.findByNameAndData(QString::fromLatin1("foo"), &device, 10, &provisional).isDefault());
+    QVERIFY(provisional);
+
+    // Some text arrives, but the time runs out before magic: not guessed to be plain text
+    StalledDevice textDevice(QByteArray("Hello world\n"));
+    QVERIFY(textDevice.open(QIODevice::ReadOnly));
+    QVERIFY(db.findByNameAndData(QString::fromLatin1("foo"), &textDevice, 10, &provisional).isDefault());
+    QVERIFY(provisional);
+
+    // Nor does the text pick the glob candidate which inherits text/plain,
+    // the first candidate by name is returned as without contents
+    StalledDevice potDevice(QByteArray("Hello world\n"));
+    QVERIFY(potDevice.open(QIODevice::ReadOnly));
+    QCOMPARE(db.findByNameAndData(QString::fromLatin1("foo.pot"), &potDevice, 10, &provisional).name(),
+             QString::fromLatin1("application/vnd.ms-powerpoint"));
+    QVERIFY(provisional);
+}
+
+void tst_qmimedatabase::test_findAsync()
+{
+    QMimeDatabase db;
+    // The default
+    QCOMPARE(db.maxAsyncThreadCount(), qBound(1, QThread::idealThreadCount(), 4));
+
+    QTemporaryFile tempFile;
+    QVERIFY(tempFile.open());
+    const QString tempFileName = tempFile.fileName();
+    tempFile.write("%PDF-");
+    tempFile.close();
+
+    QFuture<QMimeType> future = db.findByFileAsync(tempFileName);
+    QCOMPARE(future.result().name(), QString::fromLatin1("application/pdf"));
+    future = db.findByUrlAsync(QUrl::fromLocalFile(tempFileName));
+    QCOMPARE(future.result().name(), QString::fromLatin1("application/pdf"));
+    future = db.findByDataAsync(QByteArray("%PDF-"));
+    QCOMPARE(future.result().name(), QString::fromLatin1("application/pdf"));
+
+    // Not a local file: finished right away
+    future = db.findByUrlAsync(QUrl::fromEncoded("ftp://foo/bar.png"));
+    QVERIFY(future.isFinished());
+    QCOMPARE(future.result().name(), QString::fromLatin1("image/png"));
+
+    // Cancelled lookups finish too, with or without a result
+    const int maxThreadCount = db.maxAsyncThreadCount();
+    db.setMaxAsyncThreadCount(1);
+    QList<QFuture<QMimeType> > futures;
+    for (int i = 0; i < 100; ++i)
+        futures.append(db.findByFileAsync(tempFileName));
+    foreach (QFuture<QMimeType> f, futures)
+        f.cancel();
+    foreach (QFuture<QMimeType> f, futures) {
+        f.waitForFinished();
+        QVERIFY(f.isCanceled());
+    }
+    QCOMPARE(db.maxAsyncThreadCount(), 1);
+
+    // The single thread still runs the lookups which weren't cancelled
+    future = db.findByDataAsync(QByteArray("%PDF-"));
+    QCOMPARE(future.result().name(), QString::fromLatin1("application/pdf"));
+
+    db.setMaxAsyncThreadCount(maxThreadCount);
+    QCOMPARE(db.maxAsyncThreadCount(), maxThreadCount);
+}
+
+void tst_qmimedatabase::test_extendedAttributes()
+{
+#ifdef Q_OS_LINUX
+    QTemporaryFile tempFile(QDir::currentPath() + QLatin1String("/tst_qmimedatabase_XXXXXX"));
+    QVERIFY(tempFile.open());
+    const QString tempFileName = tempFile.fileName();
+    tempFile.write("%PDF-");
+    tempFile.close();
+    const QByteArray nativeFileName = QFile::encodeName(tempFileName);
+
+    QMimeDatabase db;
+    QCOMPARE(db.extendedAttributeUsage(), QMimeDatabase::IgnoreExtendedAttributes);
+
+    // A type set by the user wins over the contents
+    const QByteArray userType("image/png");
+    if (::setxattr(nativeFileName.constData(), "user.mime_type", userType.constData(), userType.size(), 0) != 0)
+        QSKIP("No user extended attributes on this filesystem", SkipSingle);
+    QCOMPARE(db.findByFile(tempFileName).name(), QString::fromLatin1("application/pdf"));
+    db.setExtendedAttributeUsage(QMimeDatabase::ReadExtendedAttributes);
+    QCOMPARE(db.findByFile(tempFileName).name(), QString::fromLatin1("image/png"));
+
+    // A type set by the user is never replaced, even one unknown to the database
+    const QByteArray unknownType("application/x-tst-qmimedatabase-unknown");
+    QCOMPARE(::setxattr(nativeFileName.constData(), "user.mime_type", unknownType.constData(), unknownType.size(), 0), 0);
+    db.setExtendedAttributeUsage(QMimeDatabase::ReadWriteExtendedAttributes);
+    QCOMPARE(db.findByFile(tempFileName).name(), QString::fromLatin1("application/pdf"));
+    char buffer[256];
+    ssize_t size = ::getxattr(nativeFileName.constData(), "user.mime_type", buffer, sizeof(buffer));
+    QCOMPARE(QByteArray(buffer, qMax(ssize_t(0), size)), unknownType);
+    QVERIFY(::getxattr(nativeFileName.constData(), "user.mime_type_stamp", buffer, sizeof(buffer)) < 0);
+    ::removexattr(nativeFileName.constData(), "user.mime_type");
+
+    // The detected type is recorded, and used while the file is unchanged
+    QCOMPARE(db.findByFile(tempFileName).name(), QString::fromLatin1("application/pdf"));
+    size = ::getxattr(nativeFileName.constData(), "user.mime_type", buffer, sizeof(buffer));
+    QCOMPARE(QByteArray(buffer, qMax(ssize_t(0), size)), QByteArray("application/pdf"));
+
+    const QMimeLookupTrace trace = db.traceFindByFile(tempFileName);
+    QCOMPARE(trace.result.name(), QString::fromLatin1("application/pdf"));
+    QCOMPARE(trace.stages.count(), 1);
+    QCOMPARE(trace.stages.first().name, QString::fromLatin1("extendedAttributes"));
+
+    // The size changes too, in case the modification time doesn't
+    QVERIFY(tempFile.open());
+    tempFile.write("<?php echo 1;");
+    tempFile.close();
+    QCOMPARE(db.findByFile(tempFileName).name(), QString::fromLatin1("application/x-php"));
+
+    db.setExtendedAttributeUsage(QMimeDatabase::IgnoreExtendedAttributes);
+#else
+    QSKIP("Extended attributes are only tested on Linux", SkipSingle);
+#endif
+}
+
 void tst_qmimedatabase::test_findByContent_data()
 {
     QTest::addColumn<QByteArray>("data");
@@ -349,6 +619,382 @@ void tst_qmimedatabase::test_allMimeTypes()
     }
 }
 
+void tst_qmimedatabase::test_allMimeTypeNames()
+{
+    QMimeDatabase db;
+    const QStringList names = db.allMimeTypeNames();
+    QCOMPARE(names.count(), 660);
+
+    QStringList sortedNames = names;
+    sortedNames.sort();
+    QCOMPARE(names, sortedNames);
+
+    // Same list, same order
+    const QList<QMimeType> lst = db.allMimeTypes();
+    QCOMPARE(lst.count(), names.count());
+    for (int i = 0; i < lst.count(); ++i)
+        QCOMPARE(lst.at(i).name(), names.at(i));
+}
+
+void tst_qmimedatabase::test_xmlCommentsLoadedOnDemand()
+{
+    QMimeDatabase db;
+    QMimeDatabasePrivate *d = db.data_ptr();
+    QMimeXMLProvider *provider = new QMimeXMLProvider(d);
+    d->setProvider(provider);
+
+    const QMimeType mime = db.mimeTypeForName(QString::fromLatin1("text/plain"));
+    QVERIFY(mime.isValid());
+    QVERIFY(mime.suffixes().contains(QString::fromLatin1("txt")));
+    QVERIFY(mime.globPatterns().contains(QString::fromLatin1("*.txt")));
+    QVERIFY(!provider->commentsLoaded());
+
+    QVERIFY(!mime.comment().isEmpty());
+    QVERIFY(provider->commentsLoaded());
+
+    d->setProvider(0); // back to the default one
+}
+
+void tst_qmimedatabase::test_statistics()
+{
+    QMimeDatabase db;
+    QVERIFY(db.findByData(QByteArray("%PDF-")).isValid()); // loads the magic rules too
+
+    const QMimeDatabaseStatistics stats = db.statistics();
+    QCOMPARE(stats.mimeTypeCount, 660);
+    QVERIFY(stats.globPatternCount > stats.mimeTypeCount);
+    QVERIFY(stats.magicMatcherCount > 0);
+    QVERIFY(stats.heapBytes > 0);
+    QVERIFY(stats.cacheBytes > 0);
+    QVERIFY(stats.loadTime >= 0);
+    if (stats.provider == QLatin1String("mime.cache")) {
+        QVERIFY(stats.mappedBytes > 0);
+    } else {
+        QCOMPARE(stats.provider, QString::fromLatin1("xml"));
+        QCOMPARE(stats.mappedBytes, qint64(0));
+    }
+}
+
+void tst_qmimedatabase::test_counters()
+{
+    QMimeDatabase db;
+    const bool wasEnabled = db.countersEnabled();
+    db.setCountersEnabled(true);
+    db.resetCounters();
+
+    QCOMPARE(db.findByName(QString::fromLatin1("foo.pdf")).name(), QString::fromLatin1("application/pdf"));
+    QCOMPARE(db.findByData(QByteArray("%PDF-")).name(), QString::fromLatin1("application/pdf"));
+    QCOMPARE(db.findByNameAndData(QString::fromLatin1("foo.pdf"), QByteArray("%PDF-")).name(), QString::fromLatin1("application/pdf"));
+    QCOMPARE(db.findByNameAndData(QString::fromLatin1("foo"), QByteArray("%PDF-")).name(), QString::fromLatin1("application/pdf"));
+
+    QMimeDatabaseCounters counters = db.counters();
+    QCOMPARE(counters.calls[QMimeDatabaseCounters::FindByName], qint64(1));
+    QCOMPARE(counters.calls[QMimeDatabaseCounters::FindByData], qint64(1));
+    QCOMPARE(counters.calls[QMimeDatabaseCounters::FindByNameAndData], qint64(2));
+    qint64 histogramTotal = 0;
+    for (int bucket = 0; bucket < QMimeDatabaseCounters::HistogramBuckets; ++bucket)
+        histogramTotal += counters.latencyHistogram[QMimeDatabaseCounters::FindByNameAndData][bucket];
+    QCOMPARE(histogramTotal, qint64(2));
+    QCOMPARE(counters.fastGlobHits, qint64(2));
+    QVERIFY(counters.magicMatchersEvaluated > 0);
+    QCOMPARE(counters.contentReadsAvoided, qint64(1));
+    QCOMPARE(counters.deviceReads, qint64(1));
+    QCOMPARE(counters.bytesRead, qint64(5));
+    QVERIFY(counters.toString().contains(QLatin1String("findByName.calls 1\n")));
+
+    db.setCountersEnabled(false);
+    db.findByName(QString::fromLatin1("foo.pdf"));
+    QCOMPARE(db.counters().calls[QMimeDatabaseCounters::FindByName], qint64(1));
+
+    db.resetCounters();
+    counters = db.counters();
+    QCOMPARE(counters.calls[QMimeDatabaseCounters::FindByName], qint64(0));
+    QCOMPARE(counters.bytesRead, qint64(0));
+
+    db.setCountersEnabled(wasEnabled);
+}
+
+void tst_qmimedatabase::test_nameCache()
+{
+    QStringList fileNames;
+    fileNames << QString::fromLatin1("foo.tar.gz") << QString::fromLatin1("bar.tar.gz")
+              << QString::fromLatin1("baz.gz") << QString::fromLatin1("README") << QString::fromLatin1("README.txt")
+              << QString::fromLatin1("notes.txt") << QString::fromLatin1("Makefile.am") << QString::fromLatin1("x.am")
+              << QString::fromLatin1("foo.C") << QString::fromLatin1("foo.c") << QString::fromLatin1(".bashrc")
+              << QString::fromLatin1("noextension") << QString::fromLatin1("dir/foo.pdf") << QString::fromLatin1("bar.PDF");
+
+    QMimeDatabase db;
+    QCOMPARE(db.nameCacheSize(), 0);
+    QStringList uncached;
+    foreach (const QString &fileName, fileNames)
+        uncached << db.findByName(fileName).name() + QLatin1Char(' ') + db.suffixForFileName(fileName);
+
+    const bool wasEnabled = db.countersEnabled();
+    db.setCountersEnabled(true);
+    db.resetCounters();
+    db.setNameCacheSize(4);
+    QCOMPARE(db.nameCacheSize(), 4);
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int i = 0; i < fileNames.count(); ++i) {
+            const QString &fileName = fileNames.at(i);
+            QCOMPARE(db.findByName(fileName).name() + QLatin1Char(' ') + db.suffixForFileName(fileName),
+                     uncached.at(i));
+        }
+    }
+    // At least the second .tar.gz, and the suffixForFileName() after each findByName()
+    const QMimeDatabaseCounters counters = db.counters();
+    QVERIFY(counters.nameCacheHits > fileNames.count());
+    QVERIFY(counters.nameCacheMisses > 0);
+
+
+    // A hidden file named like an extension has its own entry, whichever name comes first
+    const QString hidden = QString::fromLatin1(".tar.gz");
+    const QString gz = QString::fromLatin1("foo.gz");
+    db.setNameCacheSize(0);
+    const QString uncachedHidden = db.findByName(hidden).name();
+    const QString uncachedGz = db.findByName(gz).name();
+    QVERIFY(uncachedHidden != uncachedGz);
+    db.setNameCacheSize(4);
+    QCOMPARE(db.findByName(hidden).name(), uncachedHidden);
+    QCOMPARE(db.findByName(gz).name(), uncachedGz);
+    db.setNameCacheSize(0);
+    db.setNameCacheSize(4);
+    QCOMPARE(db.findByName(gz).name(), uncachedGz);
+    QCOMPARE(db.findByName(hidden).name(), uncachedHidden);
+
+    db.setNameCacheSize(0);
+    db.setCountersEnabled(wasEnabled);
+}
+
+void tst_qmimedatabase::test_trace()
+{
+    QMimeDatabase db;
+
+    const QMimeLookupTrace nameTrace = db.traceFindByName(QString::fromLatin1("foo.pdf"));
+    QCOMPARE(nameTrace.result.name(), QString::fromLatin1("application/pdf"));
+    QCOMPARE(nameTrace.accuracy, 100);
+    QVERIFY(!nameTrace.stages.isEmpty());
+    bool foundGlob = false;
+    foreach (const QMimeLookupTrace::Stage &stage, nameTrace.stages) {
+        QVERIFY(stage.time >= 0);
+        foreach (const QMimeLookupTrace::Candidate &candidate, stage.candidates) {
+            if (candidate.mimeType == QLatin1String("application/pdf") && candidate.rule == QLatin1String("*.pdf")) {
+                QCOMPARE(candidate.weight, 50);
+                foundGlob = true;
+            }
+        }
+    }
+    QVERIFY(foundGlob);
+
+    const QMimeLookupTrace dataTrace = db.traceFindByData(QByteArray("%PDF-"));
+    QCOMPARE(dataTrace.result.name(), QString::fromLatin1("application/pdf"));
+    QCOMPARE(dataTrace.stages.count(), 1);
+    const QMimeLookupTrace::Stage &magicStage = dataTrace.stages.first();
+    QCOMPARE(magicStage.name, QString::fromLatin1("magic"));
+    QVERIFY(magicStage.rulesTried > 0);
+    QCOMPARE(magicStage.bytesExamined, qint64(5));
+    bool foundMagic = false;
+    foreach (const QMimeLookupTrace::Candidate &candidate, magicStage.candidates) {
+        if (candidate.mimeType == QLatin1String("application/pdf")) {
+            QCOMPARE(candidate.rule, QString::fromLatin1("magic"));
+            foundMagic = true;
+        }
+    }
+    QVERIFY(foundMagic);
+
+    const QMimeLookupTrace fileTrace = db.traceFindByFile(QString::fromLatin1(SRCDIR "testfiles/README.pdf"));
+    QCOMPARE(fileTrace.result.name(), QString::fromLatin1("application/pdf"));
+    QCOMPARE(fileTrace.accuracy, 100);
+    QVERIFY(fileTrace.toString().startsWith(QLatin1String("findByFile(")));
+
+    // Several types match *.ts: only their magic is looked at first
+    const QMimeLookupTrace ambiguousTrace = db.traceFindByFile(QString::fromLatin1(SRCDIR "testfiles/linguist.ts"));
+    QCOMPARE(ambiguousTrace.result.name(), QString::fromLatin1("text/vnd.trolltech.linguist"));
+    bool foundCandidateMagic = false;
+    foreach (const QMimeLookupTrace::Stage &stage, ambiguousTrace.stages) {
+        if (stage.name == QLatin1String("candidateMagic"))
+            foundCandidateMagic = true;
+    }
+    QVERIFY(foundCandidateMagic);
+}
+
+class RecordingScanner : public QMimeDirectoryScanner
+{
+public:
+    QHash<QString, QString> results;
+
+protected:
+    void classified(const QString &filePath, const QMimeType &mimeType)
+    {
+        QMutexLocker locker(&m_mutex);
+        results.insert(filePath, mimeType.name());
+    }
+
+private:
+    QMutex m_mutex;
+};
+
+void tst_qmimedatabase::test_directoryScanner()
+{
+    const QString dirPath = QString::fromLatin1(SRCDIR "testfiles");
+    RecordingScanner scanner;
+    scanner.setMaxThreadCount(4);
+    scanner.scan(dirPath);
+
+    // Same results as findByFile
+    QMimeDatabase db;
+    QDirIterator it(dirPath, QDir::Files | QDir::Hidden | QDir::System, QDirIterator::Subdirectories);
+    int count = 0;
+    while (it.hasNext()) {
+        const QString filePath = it.next();
+        QVERIFY2(scanner.results.contains(filePath), qPrintable(filePath));
+        QCOMPARE(scanner.results.value(filePath), db.findByFile(filePath).name());
+        ++count;
+    }
+    QVERIFY(count > 0);
+    QCOMPARE(scanner.results.count(), count);
+}
+
+void tst_qmimedatabase::test_fileIndex()
+{
+#ifdef Q_OS_UNIX
+    const QString dirPath = QString::fromLatin1(SRCDIR "testfiles");
+    const QString indexPath = QDir::currentPath() + QLatin1String("/tst_qmimedatabase.index");
+    QFile::remove(indexPath);
+
+    QMimeFileIndex index;
+    QVERIFY(!index.load(indexPath));
+    RecordingScanner scanner;
+    scanner.setIndex(&index);
+    scanner.scan(dirPath);
+    QVERIFY(index.count() > 0);
+    QCOMPARE(index.reusedCount(), 0);
+    QVERIFY(index.save(indexPath));
+
+    // A rescan classifies nothing, with the same results
+    QMimeFileIndex loaded;
+    QVERIFY(loaded.load(indexPath));
+    QCOMPARE(loaded.loadedCount(), index.count());
+    RecordingScanner rescanner;
+    rescanner.setIndex(&loaded);
+    rescanner.scan(dirPath);
+    QCOMPARE(loaded.reusedCount(), loaded.loadedCount());
+    QCOMPARE(rescanner.results, scanner.results);
+
+    QHashIterator<QString, QString> it(scanner.results);
+    while (it.hasNext()) {
+        it.next();
+        const QString recorded = loaded.recordedMimeTypeName(it.key());
+        if (!recorded.isEmpty())
+            QCOMPARE(recorded, it.value());
+    }
+
+    // Changed files are classified again
+    QTemporaryFile tempFile(QDir::currentPath() + QLatin1String("/tst_qmimedatabase_XXXXXX"));
+    QVERIFY(tempFile.open());
+    const QString tempFileName = tempFile.fileName();
+    tempFile.write("%PDF-");
+    tempFile.close();
+    QCOMPARE(loaded.findByFile(tempFileName).name(), QString::fromLatin1("application/pdf"));
+    QVERIFY(loaded.save(indexPath));
+    QVERIFY(loaded.load(indexPath));
+    QCOMPARE(loaded.recordedMimeTypeName(tempFileName), QString::fromLatin1("application/pdf"));
+    QVERIFY(tempFile.open());
+    tempFile.write("<?php echo 1;");
+    tempFile.close();
+    QVERIFY(loaded.recordedMimeTypeName(tempFileName).isEmpty());
+    QCOMPARE(loaded.findByFile(tempFileName).name(), QString::fromLatin1("application/x-php"));
+    QCOMPARE(loaded.reusedCount(), 0);
+
+    // Nothing is reused once the MIME database changed
+    QVERIFY(loaded.save(indexPath));
+    const QByteArray oldDataHome = qgetenv("XDG_DATA_HOME");
+    const QString home = QDir::currentPath() + QLatin1String("/tst_qmimedatabase_home");
+    const QString packagesDir = home + QLatin1String("/mime/packages");
+    QVERIFY(QDir().mkpath(packagesDir));
+    const QString addedFile = packagesDir + QLatin1String("/tst-fileindex.xml");
+    QFile added(addedFile);
+    QVERIFY(added.open(QIODevice::WriteOnly));
+    added.write("<?xml version=\"1.0\"?>\n");
+    added.close();
+    qputenv("XDG_DATA_HOME", QFile::encodeName(home));
+    QMimeDatabase db;
+    db.data_ptr()->m_directoryCache.invalidate();
+    QMimeFileIndex changed;
+    QVERIFY(!changed.load(indexPath));
+    QCOMPARE(changed.loadedCount(), 0);
+    qputenv("XDG_DATA_HOME", oldDataHome);
+    db.data_ptr()->m_directoryCache.invalidate();
+    QFile::remove(addedFile);
+    QDir().rmpath(packagesDir);
+    QVERIFY(changed.load(indexPath));
+    QCOMPARE(changed.loadedCount(), loaded.count());
+
+    QFile::remove(indexPath);
+#else
+    QSKIP("Files are only indexed on Unix", SkipSingle);
+#endif
+}
+
+static bool writeFile(const QString &fileName, const QByteArray &contents,
+                      QIODevice::OpenMode mode = QIODevice::WriteOnly)
+{
+    QFile file(fileName);
+    return file.open(mode) && file.write(contents) == contents.size();
+}
+
+void tst_qmimedatabase::test_directoryCache()
+{
+    const QByteArray oldDataHome = qgetenv("XDG_DATA_HOME");
+    const QString home = QDir::currentPath() + QLatin1String("/tst_qmimedatabase_home");
+    const QString mimeDir = home + QLatin1String("/mime");
+    QVERIFY(QDir().mkpath(mimeDir + QLatin1String("/packages")));
+    QVERIFY(writeFile(mimeDir + QLatin1String("/types"), "application/x-tst-first\n"));
+    qputenv("XDG_DATA_HOME", QFile::encodeName(home));
+
+    QMimeDirectoryCache cache;
+    cache.setWatchingEnabled(false);
+
+    // Same results as QStandardPaths
+    QCOMPARE(cache.locateAll(QString::fromLatin1("types")),
+             QStandardPaths::locateAll(QStandardPaths::GenericDataLocation, QString::fromLatin1("mime/types")));
+    QCOMPARE(cache.locateAll(QString::fromLatin1("packages/freedesktop.org.xml")),
+             QStandardPaths::locateAll(QStandardPaths::GenericDataLocation,
+                                       QString::fromLatin1("mime/packages/freedesktop.org.xml")));
+    QCOMPARE(cache.locateAll(QString::fromLatin1("text/plain.xml")),
+             QStandardPaths::locateAll(QStandardPaths::GenericDataLocation, QString::fromLatin1("mime/text/plain.xml")));
+    QCOMPARE(cache.locateAllDirectories(QString::fromLatin1("packages")),
+             QStandardPaths::locateAll(QStandardPaths::GenericDataLocation, QString::fromLatin1("mime/packages"),
+                                       QStandardPaths::LocateDirectory));
+    QVERIFY(cache.locateAllDirectories(QString::fromLatin1("packages")).contains(mimeDir + QLatin1String("/packages")));
+
+    // A new file is only seen once the cache is invalidated
+    const QString addedFile = mimeDir + QLatin1String("/packages/tst-added.xml");
+    QVERIFY(writeFile(addedFile, "<?xml version=\"1.0\"?>\n"));
+    QVERIFY(!cache.locateAll(QString::fromLatin1("packages/tst-added.xml")).contains(addedFile));
+    const int generation = cache.generation();
+    cache.invalidate();
+    QCOMPARE(cache.generation(), generation + 1);
+    QVERIFY(cache.locateAll(QString::fromLatin1("packages/tst-added.xml")).contains(addedFile));
+
+    // The binary provider reloads its list of types after an invalidation
+    QMimeDatabase db;
+    QMimeDatabasePrivate *d = db.data_ptr();
+    d->m_directoryCache.invalidate(); // for the new XDG_DATA_HOME
+    QMimeBinaryProvider provider(d);
+    QVERIFY(provider.allMimeTypeNames().contains(QString::fromLatin1("application/x-tst-first")));
+    QVERIFY(writeFile(mimeDir + QLatin1String("/types"), "application/x-tst-second\n", QIODevice::Append));
+    QVERIFY(!provider.allMimeTypeNames().contains(QString::fromLatin1("application/x-tst-second")));
+    d->m_directoryCache.invalidate();
+    QVERIFY(provider.allMimeTypeNames().contains(QString::fromLatin1("application/x-tst-second")));
+
+    qputenv("XDG_DATA_HOME", oldDataHome);
+    d->m_directoryCache.invalidate();
+    QFile::remove(addedFile);
+    QFile::remove(mimeDir + QLatin1String("/types"));
+    QDir().rmpath(mimeDir + QLatin1String("/packages"));
+}
+
 void tst_qmimedatabase::test_inheritsPerformance()
 {
     // Check performance of inherits().
@@ -21,6 +21,7 @@ private slots:
     void initTestCase();
 
     void test_mimeTypeForName();
+    void test_retainedLocales();
     void test_findByName_data();
     void test_findByName();
     void test_inheritance();
@@ -28,11 +29,25 @@ private slots:
     void test_icons();
     void test_findByFileWithContent();
     void test_findByUrl();
+    void test_lookupOptions();
+    void test_findByDeviceKeepsData();
+    void test_findWithDeadline();
+    void test_findAsync();
+    void test_extendedAttributes();
     void test_findByContent_data();
     void test_findByContent();
     void test_findByNameAndContent_data();
     void test_findByNameAndContent();
     void test_allMimeTypes();
+    void test_allMimeTypeNames();
+    void test_xmlCommentsLoadedOnDemand();
+    void test_statistics();
+    void test_counters();
+    void test_nameCache();
+    void test_trace();
+    void test_directoryScanner();
+    void test_fileIndex();
+    void test_directoryCache();
     void test_inheritsPerformance();
     void test_suffixes_data();
     void test_suffixes();
@@ -0,0 +1,8 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    qmimeallocations \
+    qmimecoldstart \
+    qmimedatabase \
+    qmimeproviders \
+    qmimexmlparser
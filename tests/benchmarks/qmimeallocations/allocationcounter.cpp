@@ -0,0 +1,86 @@
+/****************************************************************************
+**
+** TODO Provide Licensing information
+**
+****************************************************************************/
+
+#include "allocationcounter.h"
+
+#include <stdlib.h>
+
+static bool counting = false;
+static qint64 allocationCount = 0;
+static qint64 allocatedBytes = 0;
+
+#ifdef __GLIBC__
+
+// The functions the glibc allocator exports under a second name, so that
+// the replacements below can forward to them
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+}
+
+static inline void countAllocation(size_t size)
+{
+    if (counting) {
+        ++allocationCount;
+        allocatedBytes += size;
+    }
+}
+
+extern "C" void *malloc(size_t size) __THROW
+{
+    countAllocation(size);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) __THROW
+{
+    countAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size) __THROW
+{
+    if (size)
+        countAllocation(size);
+    return __libc_realloc(ptr, size);
+}
+
+bool AllocationCounter::isSupported()
+{
+    return true;
+}
+
+#else
+
+bool AllocationCounter::isSupported()
+{
+    return false;
+}
+
+#endif
+
+void AllocationCounter::start()
+{
+    allocationCount = 0;
+    allocatedBytes = 0;
+    counting = true;
+}
+
+void AllocationCounter::stop()
+{
+    counting = false;
+}
+
+qint64 AllocationCounter::allocations()
+{
+    return allocationCount;
+}
+
+qint64 AllocationCounter::bytes()
+{
+    return allocatedBytes;
+}
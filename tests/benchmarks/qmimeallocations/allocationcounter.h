@@ -0,0 +1,27 @@
+/****************************************************************************
+**
+** TODO Provide Licensing information
+**
+****************************************************************************/
+
+#ifndef ALLOCATIONCOUNTER_H_INCLUDED
+#define ALLOCATIONCOUNTER_H_INCLUDED
+
+#include <QtCore/QtGlobal>
+
+// Counts the calls to malloc, calloc and realloc made by the whole process between
+// start() and stop(), including those of Qt and of operator new. This replaces the
+// glibc allocation functions, so it isn't supported elsewhere.
+class AllocationCounter
+{
+public:
+    static bool isSupported();
+
+    static void start();
+    static void stop();
+
+    static qint64 allocations();
+    static qint64 bytes();
+};
+
+#endif   // ALLOCATIONCOUNTER_H_INCLUDED
@@ -0,0 +1,23 @@
+include(../../../../mimetypes.pri)
+
+TEMPLATE = app
+
+TARGET = tst_bench_qmimeallocations-cache
+
+QT       += testlib
+
+QT       -= widgets gui
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+CONFIG += depend_includepath
+
+SOURCES += tst_bench_qmimeallocations-cache.cpp \
+           ../allocationcounter.cpp
+HEADERS += ../tst_bench_qmimeallocations.h \
+           ../allocationcounter.h
+
+DEFINES += SRCDIR='"\\"$$PWD/../\\""'
+
+QMAKE_CXXFLAGS += -W -Wall -Wextra -Werror -Wshadow -Wno-long-long -Wnon-virtual-dtor
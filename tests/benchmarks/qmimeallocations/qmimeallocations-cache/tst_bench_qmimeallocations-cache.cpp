@@ -0,0 +1,32 @@
+#include "../tst_bench_qmimeallocations.h"
+#include <QDir>
+#include <QFile>
+#include <QtTest/QtTest>
+#include <qstandardpaths.h>
+
+#include "../tst_bench_qmimeallocations.cpp"
+
+tst_bench_qmimeallocations::tst_bench_qmimeallocations()
+    : m_variant(QString::fromLatin1("cache")), m_expectedProvider(QString::fromLatin1("mime.cache"))
+{
+    // Same setup as tests/auto/qmimedatabase/qmimedatabase-cache
+    qputenv("XDG_DATA_HOME", QByteArray("doesnotexist"));
+
+    QDir here = QDir::currentPath();
+    here.mkpath(QString::fromLatin1("mime/packages"));
+    QFile xml(QFile::decodeName(SRCDIR "../../../src/mimetypes/mime/packages/freedesktop.org.xml"));
+    const QString tempMime = here.absolutePath() + QString::fromLatin1("/mime");
+    xml.copy(tempMime + QString::fromLatin1("/packages/freedesktop.org.xml"));
+
+    const QString umd = QStandardPaths::findExecutable(QString::fromLatin1("update-mime-database"));
+    if (umd.isEmpty())
+        QSKIP("shared-mime-info not found, skipping mime.cache allocation benchmarks", SkipAll);
+
+    QProcess proc;
+    proc.setProcessChannelMode(QProcess::MergedChannels); // silence output
+    proc.start(umd, QStringList() << tempMime);
+    proc.waitForFinished();
+
+    QVERIFY(QFile::exists(tempMime + QString::fromLatin1("/mime.cache")));
+    qputenv("XDG_DATA_DIRS", QFile::encodeName(here.absolutePath()));
+}
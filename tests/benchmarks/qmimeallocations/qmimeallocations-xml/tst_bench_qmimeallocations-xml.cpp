@@ -0,0 +1,12 @@
+#include "../tst_bench_qmimeallocations.h"
+
+tst_bench_qmimeallocations::tst_bench_qmimeallocations()
+    : m_variant(QString::fromLatin1("xml")), m_expectedProvider(QString::fromLatin1("xml"))
+{
+    // Same setup as tests/auto/qmimedatabase/qmimedatabase-xml
+    qputenv("XDG_DATA_DIRS", SRCDIR "../../../src/mimetypes/mime");
+    qputenv("XDG_DATA_HOME", QByteArray("doesnotexist"));
+    qputenv("QT_NO_MIME_CACHE", "1");
+}
+
+#include "../tst_bench_qmimeallocations.cpp"
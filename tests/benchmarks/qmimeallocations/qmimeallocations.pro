@@ -0,0 +1,3 @@
+TEMPLATE = subdirs
+SUBDIRS = qmimeallocations-xml
+unix: SUBDIRS += qmimeallocations-cache
@@ -0,0 +1,154 @@
+/****************************************************************************
+**
+** TODO Provide Licensing information
+**
+****************************************************************************/
+
+#include "tst_bench_qmimeallocations.h"
+#include "allocationcounter.h"
+
+#include <qmimedatabase.h>
+
+#include <QtCore/QFile>
+#include <QtCore/QStringList>
+
+#include <QtTest/QtTest>
+
+void tst_bench_qmimeallocations::initTestCase()
+{
+    QMimeDatabase db;
+    const QString provider = db.statistics().provider;
+    if (provider != m_expectedProvider)
+        QSKIP(qPrintable(QString::fromLatin1("Using the %1 provider instead of %2").arg(provider, m_expectedProvider)), SkipAll);
+
+    // Load everything the lookups need up front
+    db.findByData(QByteArray("%PDF-"));
+    db.mimeTypeForName(QString::fromLatin1("text/plain")).comment();
+
+    QFile expectations(allocationsFileName());
+    if (expectations.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        while (!expectations.atEnd()) {
+            // Comment lines start with #, so they never have the three fields
+            const QStringList fields = QString::fromUtf8(expectations.readLine().constData()).trimmed().split(QLatin1Char('\t'));
+            if (fields.count() == 3)
+                m_expectedAllocations.insert(fields.at(0), qMakePair(fields.at(1).toLongLong(), fields.at(2).toLongLong()));
+        }
+    }
+}
+
+void tst_bench_qmimeallocations::cleanupTestCase()
+{
+    if (m_recordedAllocations.isEmpty())
+        return;
+
+    QFile expectations(allocationsFileName());
+    QVERIFY2(expectations.open(QIODevice::WriteOnly | QIODevice::Text), qPrintable(expectations.fileName()));
+    expectations.write("# Allocations and bytes per call of tst_bench_qmimeallocations-" + m_variant.toLatin1()
+                       + ", written with QMIME_RECORD_ALLOCATIONS=1\n");
+    QMap<QString, QPair<qint64, qint64> >::const_iterator it = m_recordedAllocations.constBegin();
+    for ( ; it != m_recordedAllocations.constEnd(); ++it) {
+        const QString line = QString::fromLatin1("%1\t%2\t%3\n").arg(it.key()).arg(it.value().first).arg(it.value().second);
+        expectations.write(line.toUtf8());
+    }
+    qDebug("Recorded the allocations in %s", qPrintable(expectations.fileName()));
+}
+
+// The checked-in allocations per call, written by running with QMIME_RECORD_ALLOCATIONS=1
+QString tst_bench_qmimeallocations::allocationsFileName() const
+{
+    return QString::fromLatin1(SRCDIR "allocations-") + m_variant + QLatin1String(".txt");
+}
+
+enum LookupOperation {
+    MimeTypeForName,
+    FindByName,
+    FindByData,
+    FindByFile
+};
+
+Q_DECLARE_METATYPE(LookupOperation)
+
+void tst_bench_qmimeallocations::allocations_data()
+{
+    QTest::addColumn<LookupOperation>("operation");
+    QTest::addColumn<QString>("argument");
+    QTest::addColumn<QByteArray>("data");
+
+    QTest::newRow("mimeTypeForName text/plain") << MimeTypeForName << QString::fromLatin1("text/plain") << QByteArray();
+    QTest::newRow("mimeTypeForName alias") << MimeTypeForName << QString::fromLatin1("application/x-pdf") << QByteArray();
+    QTest::newRow("findByName fast extension") << FindByName << QString::fromLatin1("foo.txt") << QByteArray();
+    QTest::newRow("findByName multi-dot") << FindByName << QString::fromLatin1("foo.tar.bz2") << QByteArray();
+    QTest::newRow("findByName literal") << FindByName << QString::fromLatin1("Makefile") << QByteArray();
+    QTest::newRow("findByName unknown") << FindByName << QString::fromLatin1("foo.doesnotexist") << QByteArray();
+    QTest::newRow("findByData pdf") << FindByData << QString() << QByteArray("%PDF-1.4\n");
+    QTest::newRow("findByData text") << FindByData << QString() << QByteArray("Hello world, this is some plain text\n");
+    QTest::newRow("findByFile pdf") << FindByFile << QString::fromLatin1(SRCDIR "../../auto/qmimedatabase/testfiles/README.pdf") << QByteArray();
+    QTest::newRow("findByFile by contents") << FindByFile << QString::fromLatin1(SRCDIR "../../auto/qmimedatabase/testfiles/test.ogg") << QByteArray();
+}
+
+static void runLookup(const QMimeDatabase &db, LookupOperation operation, const QString &argument, const QByteArray &data)
+{
+    switch (operation) {
+    case MimeTypeForName:
+        db.mimeTypeForName(argument);
+        break;
+    case FindByName:
+        db.findByName(argument);
+        break;
+    case FindByData:
+        db.findByData(data);
+        break;
+    case FindByFile:
+        db.findByFile(argument);
+        break;
+    }
+}
+
+// Fails when a case allocates more, or more bytes, than recorded in allocations-<variant>.txt
+void tst_bench_qmimeallocations::allocations()
+{
+    QFETCH(LookupOperation, operation);
+    QFETCH(QString, argument);
+    QFETCH(QByteArray, data);
+
+    if (!AllocationCounter::isSupported())
+        QSKIP("Counting the allocations needs glibc", SkipAll);
+
+    const QString row = QString::fromLatin1(QTest::currentDataTag());
+    const bool record = !qgetenv("QMIME_RECORD_ALLOCATIONS").isEmpty();
+
+    QMimeDatabase db;
+    runLookup(db, operation, argument, data); // whatever is loaded on first use isn't counted
+
+    const int calls = 100;
+    AllocationCounter::start();
+    for (int i = 0; i < calls; ++i)
+        runLookup(db, operation, argument, data);
+    AllocationCounter::stop();
+
+    const qint64 allocations = (AllocationCounter::allocations() + calls / 2) / calls;
+    const qint64 bytes = (AllocationCounter::bytes() + calls / 2) / calls;
+    qDebug("%lld allocations, %lld bytes per call", allocations, bytes);
+
+    if (record) {
+        m_recordedAllocations.insert(row, qMakePair(allocations, bytes));
+        return;
+    }
+    QVERIFY2(m_expectedAllocations.contains(row),
+             qPrintable(QString::fromLatin1("No expected allocations in %1, record them with QMIME_RECORD_ALLOCATIONS=1")
+                        .arg(allocationsFileName())));
+
+    const QPair<qint64, qint64> expected = m_expectedAllocations.value(row);
+    QVERIFY2(allocations <= expected.first,
+             qPrintable(QString::fromLatin1("%1 allocations per call, expected at most %2").arg(allocations).arg(expected.first)));
+    QVERIFY2(bytes <= expected.second,
+             qPrintable(QString::fromLatin1("%1 bytes per call, expected at most %2").arg(bytes).arg(expected.second)));
+    if (allocations < expected.first)
+        qDebug("Fewer allocations than expected, record them again with QMIME_RECORD_ALLOCATIONS=1");
+}
+
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 0, 0))
+QTEST_GUILESS_MAIN(tst_bench_qmimeallocations)
+#else
+QTEST_MAIN(tst_bench_qmimeallocations)
+#endif
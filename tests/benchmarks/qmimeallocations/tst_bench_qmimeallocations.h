@@ -0,0 +1,39 @@
+/****************************************************************************
+**
+** TODO Provide Licensing information
+**
+****************************************************************************/
+
+#ifndef TST_BENCH_QMIMEALLOCATIONS_H_INCLUDED
+#define TST_BENCH_QMIMEALLOCATIONS_H_INCLUDED
+
+#include <QtCore/QMap>
+#include <QtCore/QObject>
+#include <QtCore/QPair>
+#include <QtCore/QString>
+
+// A binary of its own, because it replaces the allocation functions of the whole process
+class tst_bench_qmimeallocations : public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_bench_qmimeallocations();
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void allocations_data();
+    void allocations();
+
+private:
+    QString allocationsFileName() const;
+
+    const QString m_variant;
+    const QString m_expectedProvider;
+    QMap<QString, QPair<qint64, qint64> > m_expectedAllocations; // row -> allocations, bytes per call
+    QMap<QString, QPair<qint64, qint64> > m_recordedAllocations;
+};
+
+#endif   // TST_BENCH_QMIMEALLOCATIONS_H_INCLUDED
@@ -0,0 +1,169 @@
+/****************************************************************************
+**
+** TODO Provide Licensing information
+**
+****************************************************************************/
+
+// Measures how long a fresh process takes to answer its first MIME type lookups,
+// for the mime.cache and the XML providers, by running itself again N times.
+//
+// Usage: qmimecoldstart [-n runs] [-budget-cache ms] [-budget-xml ms]
+//
+// The budgets apply to the p99 of the in-process time to the first name and data
+// lookups; the exit code is 1 when one of them is exceeded.
+
+#include "qmimedatabase.h"
+#include "qmimedatabase_p.h"
+#include "qmimeprovider_p.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QProcess>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+#include <algorithm>
+#include <stdio.h>
+
+enum Phase {
+    Discovery,   // finding the mime directories
+    Provider,    // finding and mapping mime.cache, or nothing for XML
+    FirstName,   // the first findByName, which parses the XML types and builds the glob index
+    FirstData,   // the first findByData, which parses the XML magic rules
+    InProcess,   // all of the above
+    Process,     // the whole child process, as seen from the parent
+    PhaseCount
+};
+
+static const char *const phaseNames[PhaseCount] = {
+    "discovery", "provider", "first findByName", "first findByData", "in process", "process"
+};
+
+static const char childOption[] = "-child";
+
+// Does the first lookups and prints the microseconds spent in each phase, then the provider
+static int runChild()
+{
+    QMimeDatabasePrivate *d = QMimeDatabasePrivate::instance();
+    QMutexLocker locker(&d->mutex);
+    QElapsedTimer timer;
+    qint64 times[InProcess];
+
+    timer.start();
+    d->m_directoryCache.mimeDirectories();
+    times[Discovery] = timer.nsecsElapsed() / 1000;
+
+    timer.restart();
+    d->provider();
+    times[Provider] = timer.nsecsElapsed() / 1000;
+
+    timer.restart();
+    d->findByName(QString::fromLatin1("foo.txt"));
+    times[FirstName] = timer.nsecsElapsed() / 1000;
+
+    timer.restart();
+    int accuracy = 0;
+    d->findByData(QByteArray("%PDF-"), &accuracy);
+    times[FirstData] = timer.nsecsElapsed() / 1000;
+
+    QMimeDatabaseStatistics stats;
+    d->provider()->addStatistics(stats);
+
+    for (int phase = 0; phase < InProcess; ++phase)
+        printf("%lld ", times[phase]);
+    printf("%s\n", stats.provider.toLatin1().constData());
+    return 0;
+}
+
+static qint64 percentile(QVector<qint64> values, int percent)
+{
+    std::sort(values.begin(), values.end());
+    const int index = (values.count() * percent + 99) / 100 - 1;
+    return values.at(qMax(0, index));
+}
+
+// Runs the child \a runs times and prints the percentiles of each phase.
+// Returns the p99 of the in-process time, or -1 if the provider couldn't be used.
+static qint64 measure(const QString &provider, int runs)
+{
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    if (provider == QLatin1String("xml"))
+        environment.insert(QString::fromLatin1("QT_NO_MIME_CACHE"), QString::fromLatin1("1"));
+    else
+        environment.remove(QString::fromLatin1("QT_NO_MIME_CACHE"));
+
+    QVector<qint64> times[PhaseCount];
+    for (int run = 0; run < runs; ++run) {
+        QProcess child;
+        child.setProcessEnvironment(environment);
+        QElapsedTimer timer;
+        timer.start();
+        child.start(QCoreApplication::applicationFilePath(), QStringList() << QString::fromLatin1(childOption));
+        if (!child.waitForFinished() || child.exitCode() != 0) {
+            fprintf(stderr, "The child process failed: %s\n", child.errorString().toLocal8Bit().constData());
+            return -1;
+        }
+        const qint64 processTime = timer.nsecsElapsed() / 1000;
+
+        const QStringList fields = QString::fromLatin1(child.readAllStandardOutput().constData()).simplified().split(QLatin1Char(' '));
+        if (fields.count() != InProcess + 1) {
+            fprintf(stderr, "Unexpected output from the child process\n");
+            return -1;
+        }
+        if (fields.last() != provider) {
+            printf("%s: not available, %s was used instead\n\n", qPrintable(provider), qPrintable(fields.last()));
+            return -1;
+        }
+        qint64 inProcess = 0;
+        for (int phase = 0; phase < InProcess; ++phase) {
+            const qint64 time = fields.at(phase).toLongLong();
+            times[phase].append(time);
+            inProcess += time;
+        }
+        times[InProcess].append(inProcess);
+        times[Process].append(processTime);
+    }
+
+    printf("%s, %d runs (microseconds)\n", qPrintable(provider), runs);
+    printf("  %-18s %10s %10s\n", "", "p50", "p99");
+    for (int phase = 0; phase < PhaseCount; ++phase)
+        printf("  %-18s %10lld %10lld\n", phaseNames[phase], percentile(times[phase], 50), percentile(times[phase], 99));
+    printf("\n");
+    return percentile(times[InProcess], 99);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    const QStringList args = app.arguments();
+    if (args.count() > 1 && args.at(1) == QLatin1String(childOption))
+        return runChild();
+
+    int runs = 20;
+    qint64 cacheBudget = -1;
+    qint64 xmlBudget = -1;
+    for (int i = 1; i < args.count() - 1; i += 2) {
+        const QString &option = args.at(i);
+        const qint64 value = args.at(i + 1).toLongLong();
+        if (option == QLatin1String("-n"))
+            runs = qMax(1, int(value));
+        else if (option == QLatin1String("-budget-cache"))
+            cacheBudget = value * 1000;
+        else if (option == QLatin1String("-budget-xml"))
+            xmlBudget = value * 1000;
+    }
+
+    bool overBudget = false;
+    const qint64 cacheTime = measure(QString::fromLatin1("mime.cache"), runs);
+    if (cacheBudget >= 0 && cacheTime > cacheBudget) {
+        printf("mime.cache: the p99 of %lld us is over the budget of %lld us\n", cacheTime, cacheBudget);
+        overBudget = true;
+    }
+    const qint64 xmlTime = measure(QString::fromLatin1("xml"), runs);
+    if (xmlBudget >= 0 && xmlTime > xmlBudget) {
+        printf("xml: the p99 of %lld us is over the budget of %lld us\n", xmlTime, xmlBudget);
+        overBudget = true;
+    }
+    return overBudget ? 1 : 0;
+}
@@ -0,0 +1,16 @@
+include(../../../mimetypes.pri)
+
+TEMPLATE = app
+
+TARGET = qmimecoldstart
+
+QT       -= widgets gui
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+CONFIG += depend_includepath
+
+SOURCES += main.cpp
+
+QMAKE_CXXFLAGS += -W -Wall -Wextra -Werror -Wshadow -Wno-long-long -Wnon-virtual-dtor
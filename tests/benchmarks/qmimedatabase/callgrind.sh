@@ -0,0 +1,110 @@
+#!/bin/sh
+
+#
+# Runs the fixed lookup workloads of tst_bench_qmimedatabase under callgrind
+# (the -callgrind backend of QTest, valgrind must be installed) and compares
+# their instruction counts to the baseline checked in next to this script.
+# Unlike timings, instruction counts don't depend on the load of the machine,
+# so regressions of the glob and magic engines show up reliably.
+#
+# Usage: callgrind.sh [-update] <xml|cache> <tst_bench_qmimedatabase binary>
+#
+# The variant (xml or cache) must match the binary, it selects the baseline
+# file callgrind-baseline-<variant>.txt. With -update, the baseline is written
+# with the current counts instead of being compared to them.
+# The tolerance is 2 percent, set CALLGRIND_TOLERANCE to change it.
+# Lines starting with # in the baseline are comments. A missing baseline, one
+# without any counts, or a machine without valgrind fails the check.
+#
+
+workloads="globWorkload magicWorkload"
+
+usage()
+{
+    echo "Usage: $0 [-update] <xml|cache> <tst_bench_qmimedatabase binary>"
+    exit 2
+}
+
+update=
+if [ "$1" = "-update" ]; then
+    update=1
+    shift
+fi
+[ $# -eq 2 ] || usage
+
+variant=$1
+binary=$2
+tolerance=${CALLGRIND_TOLERANCE:-2}
+baseline=`dirname $0`/callgrind-baseline-$variant.txt
+
+if [ -z "$update" ]; then
+    if [ ! -f $baseline ]; then
+        echo "No baseline in $baseline, record one with: $0 -update $variant $binary"
+        exit 2
+    fi
+    if ! grep -v '^#' $baseline | grep -q .; then
+        echo "No instruction counts in $baseline, record them with: $0 -update $variant $binary"
+        exit 2
+    fi
+fi
+
+if ! command -v valgrind > /dev/null 2>&1; then
+    echo "valgrind not found, it is needed to count the instructions"
+    exit 1
+fi
+
+output=`mktemp`
+results=`mktemp`
+trap 'rm -f $output $results' 0
+
+if ! "$binary" -callgrind -xml $workloads > $output; then
+    cat $output
+    echo "$binary failed"
+    exit 1
+fi
+
+# One "<function> <instructions>" line per workload
+awk '
+    /<TestFunction name="/ { split($0, parts, "\""); name = parts[2] }
+    /<BenchmarkResult/ && /metric="InstructionReads"/ {
+        if (match($0, /value="[^"]*"/))
+            print name, substr($0, RSTART + 7, RLENGTH - 8) + 0
+    }
+' $output > $results
+
+if [ `wc -l < $results` -ne `echo $workloads | wc -w` ]; then
+    cat $output
+    echo "Missing instruction counts in the output of $binary"
+    exit 1
+fi
+
+if [ -n "$update" ]; then
+    {
+        echo "# Instruction counts of tst_bench_qmimedatabase-$variant, written by callgrind.sh -update"
+        cat $results
+    } > $baseline
+    echo "Updated $baseline:"
+    cat $baseline
+    exit 0
+fi
+
+awk -v tolerance=$tolerance '
+    /^#/ { next }
+    NR == FNR { baseline[$1] = $2; next }
+    {
+        if (!($1 in baseline)) {
+            print $1 ": not in the baseline"
+            failed = 1
+            next
+        }
+        change = ($2 - baseline[$1]) * 100 / baseline[$1]
+        printf "%s: %.0f instructions, baseline %.0f (%+.2f%%)\n", $1, $2, baseline[$1], change
+        if (change > tolerance) {
+            print "    regression above the tolerance of " tolerance "%"
+            failed = 1
+        } else if (change < -tolerance) {
+            print "    improvement, update the baseline with -update"
+        }
+    }
+    END { exit failed }
+' $baseline $results
@@ -0,0 +1,27 @@
+include(../../../../mimetypes.pri)
+
+TEMPLATE = app
+
+TARGET = tst_bench_qmimedatabase-xml
+
+QT       += testlib
+
+QT       -= widgets gui
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+CONFIG += depend_includepath
+
+SOURCES += tst_bench_qmimedatabase-xml.cpp
+HEADERS += ../tst_bench_qmimedatabase.h
+
+DEFINES += SRCDIR='"\\"$$PWD/../\\""'
+
+QMAKE_CXXFLAGS += -W -Wall -Wextra -Werror -Wshadow -Wno-long-long -Wnon-virtual-dtor
+
+# make check: compares the instruction counts to callgrind-baseline-xml.txt
+callgrind.commands = sh $$PWD/../callgrind.sh xml ./$(TARGET)
+callgrind.depends = $(TARGET)
+check.depends = callgrind
+QMAKE_EXTRA_TARGETS += callgrind check
@@ -0,0 +1,12 @@
+#include "../tst_bench_qmimedatabase.h"
+
+tst_bench_qmimedatabase::tst_bench_qmimedatabase()
+    : m_expectedProvider(QString::fromLatin1("xml"))
+{
+    // Same setup as tests/auto/qmimedatabase/qmimedatabase-xml
+    qputenv("XDG_DATA_DIRS", SRCDIR "../../../src/mimetypes/mime");
+    qputenv("XDG_DATA_HOME", QByteArray("doesnotexist"));
+    qputenv("QT_NO_MIME_CACHE", "1");
+}
+
+#include "../tst_bench_qmimedatabase.cpp"
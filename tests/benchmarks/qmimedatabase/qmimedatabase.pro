@@ -0,0 +1,5 @@
+TEMPLATE = subdirs
+SUBDIRS = qmimedatabase-xml
+unix: SUBDIRS += qmimedatabase-cache
+
+OTHER_FILES = callgrind.sh
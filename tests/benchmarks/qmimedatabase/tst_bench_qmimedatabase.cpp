@@ -0,0 +1,257 @@
+/****************************************************************************
+**
+** TODO Provide Licensing information
+**
+****************************************************************************/
+
+#include "tst_bench_qmimedatabase.h"
+
+#include <qmimedatabase.h>
+#include "qmimedatabase_p.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+
+#include <QtTest/QtTest>
+
+// The file names of the shared-mime-info test suite, see tests/auto/qmimedatabase/testfiles/list
+static QStringList corpusFileNames(const QString &prefix)
+{
+    QStringList fileNames;
+    QFile f(prefix + QLatin1String("list"));
+    if (!f.open(QIODevice::ReadOnly))
+        return fileNames;
+
+    QByteArray line(1024, Qt::Uninitialized);
+    while (!f.atEnd()) {
+        const int len = f.readLine(line.data(), 1023);
+        if (len <= 2 || line.at(0) == '#')
+            continue;
+        const QString string = QString::fromLatin1(line.constData(), len - 1).trimmed();
+        const QStringList list = string.split(QLatin1Char(' '), QString::SkipEmptyParts);
+        if (!list.isEmpty())
+            fileNames.append(prefix + list.at(0));
+    }
+    return fileNames;
+}
+
+void tst_bench_qmimedatabase::initTestCase()
+{
+    QMimeDatabase db;
+    const QString provider = db.statistics().provider;
+    if (provider != m_expectedProvider)
+        QSKIP(qPrintable(QString::fromLatin1("Using the %1 provider instead of %2").arg(provider, m_expectedProvider)), SkipAll);
+
+    m_corpusFiles = corpusFileNames(QString::fromLatin1(SRCDIR "../../auto/qmimedatabase/testfiles/"));
+    QVERIFY(!m_corpusFiles.isEmpty());
+    foreach (const QString &fileName, m_corpusFiles) {
+        QFile file(fileName);
+        QVERIFY2(file.open(QIODevice::ReadOnly), qPrintable(fileName));
+        m_corpusData.append(file.read(16384));
+    }
+
+    // Load everything the lookups need up front, so that the first iteration doesn't pay for it
+    db.findByData(QByteArray("%PDF-"));
+    db.mimeTypeForName(QString::fromLatin1("text/plain")).comment();
+}
+
+void tst_bench_qmimedatabase::mimeTypeForName_data()
+{
+    QTest::addColumn<QString>("name");
+
+    QTest::newRow("common") << QString::fromLatin1("text/plain");
+    QTest::newRow("last") << QString::fromLatin1("video/x-theora+ogg");
+    QTest::newRow("alias") << QString::fromLatin1("application/x-pdf");
+    QTest::newRow("unknown") << QString::fromLatin1("application/x-doesnotexist");
+}
+
+void tst_bench_qmimedatabase::mimeTypeForName()
+{
+    QFETCH(QString, name);
+
+    QMimeDatabase db;
+    QBENCHMARK {
+        db.mimeTypeForName(name);
+    }
+}
+
+void tst_bench_qmimedatabase::findByName_data()
+{
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<QString>("mimeTypeName");
+
+    // The bundled database has no glob with a weight above 50, the literal and
+    // case-sensitive globs are the closest to the high weight list.
+    QTest::newRow("fast extension") << QString::fromLatin1("foo.txt") << QString::fromLatin1("text/plain");
+    QTest::newRow("fast extension, upper case") << QString::fromLatin1("FOO.PDF") << QString::fromLatin1("application/pdf");
+    QTest::newRow("multi-dot") << QString::fromLatin1("foo.tar.bz2") << QString::fromLatin1("application/x-bzip-compressed-tar");
+    QTest::newRow("dots in the name") << QString::fromLatin1("my.file.with.dots.txt") << QString::fromLatin1("text/plain");
+    QTest::newRow("literal") << QString::fromLatin1("Makefile") << QString::fromLatin1("text/x-makefile");
+    QTest::newRow("case-sensitive") << QString::fromLatin1("foo.C") << QString::fromLatin1("text/x-c++src");
+    QTest::newRow("prefix glob") << QString::fromLatin1("README.txt") << QString::fromLatin1("text/plain");
+    QTest::newRow("suffix glob") << QString::fromLatin1("foo~") << QString::fromLatin1("application/x-trash");
+    QTest::newRow("character class") << QString::fromLatin1("001.vdr") << QString::fromLatin1("video/mpeg");
+    QTest::newRow("unknown") << QString::fromLatin1("foo.doesnotexist") << QString::fromLatin1("application/octet-stream");
+    QTest::newRow("no extension") << QString::fromLatin1("foo") << QString::fromLatin1("application/octet-stream");
+}
+
+void tst_bench_qmimedatabase::findByName()
+{
+    QFETCH(QString, fileName);
+    QFETCH(QString, mimeTypeName);
+
+    QMimeDatabase db;
+    QCOMPARE(db.findByName(fileName).name(), mimeTypeName);
+    QBENCHMARK {
+        db.findByName(fileName);
+    }
+}
+
+void tst_bench_qmimedatabase::findByData_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<QString>("mimeTypeName");
+
+    QTest::newRow("pdf") << QByteArray("%PDF-1.4\n") << QString::fromLatin1("application/pdf");
+    QTest::newRow("png") << QByteArray("\x89PNG\r\n\x1a\n\0\0\0\rIHDR", 16) << QString::fromLatin1("image/png");
+    QTest::newRow("text") << QByteArray("Hello world, this is some plain text\n") << QString::fromLatin1("text/plain");
+    QTest::newRow("binary") << QByteArray("\x01\x02\x03\x04\x05\x06\x07\x08", 8) << QString::fromLatin1("application/octet-stream");
+    QTest::newRow("empty") << QByteArray() << QString::fromLatin1("application/x-zerosize");
+}
+
+void tst_bench_qmimedatabase::findByData()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(QString, mimeTypeName);
+
+    QMimeDatabase db;
+    QCOMPARE(db.findByData(data).name(), mimeTypeName);
+    QBENCHMARK {
+        db.findByData(data);
+    }
+}
+
+void tst_bench_qmimedatabase::findByDataCorpus()
+{
+    QMimeDatabase db;
+    QBENCHMARK {
+        foreach (const QByteArray &data, m_corpusData)
+            db.findByData(data);
+    }
+}
+
+void tst_bench_qmimedatabase::findByFileCorpus()
+{
+    QMimeDatabase db;
+    QBENCHMARK {
+        foreach (const QString &fileName, m_corpusFiles)
+            db.findByFile(fileName);
+    }
+}
+
+void tst_bench_qmimedatabase::inherits_data()
+{
+    QTest::addColumn<QString>("name");
+    QTest::addColumn<QString>("parent");
+    QTest::addColumn<bool>("result");
+
+    QTest::newRow("direct parent") << QString::fromLatin1("text/x-csrc") << QString::fromLatin1("text/plain") << true;
+    QTest::newRow("grand parent") << QString::fromLatin1("text/x-chdr") << QString::fromLatin1("text/plain") << true;
+    QTest::newRow("unrelated") << QString::fromLatin1("text/x-chdr") << QString::fromLatin1("image/png") << false;
+}
+
+void tst_bench_qmimedatabase::inherits()
+{
+    QFETCH(QString, name);
+    QFETCH(QString, parent);
+    QFETCH(bool, result);
+
+    QMimeDatabase db;
+    const QMimeType mime = db.mimeTypeForName(name);
+    QCOMPARE(mime.inherits(parent), result);
+    QBENCHMARK {
+        mime.inherits(parent);
+    }
+}
+
+void tst_bench_qmimedatabase::allParentMimeTypes()
+{
+    QMimeDatabase db;
+    const QMimeType mime = db.mimeTypeForName(QString::fromLatin1("text/x-chdr"));
+    QVERIFY(mime.allParentMimeTypes().contains(QString::fromLatin1("text/plain")));
+    QBENCHMARK {
+        mime.allParentMimeTypes();
+    }
+}
+
+void tst_bench_qmimedatabase::comment_data()
+{
+    QTest::addColumn<QString>("locale");
+
+    QTest::newRow("default") << QString();
+    QTest::newRow("en_US") << QString::fromLatin1("en_US");
+    QTest::newRow("fr, maybe not retained") << QString::fromLatin1("fr");
+}
+
+void tst_bench_qmimedatabase::comment()
+{
+    QFETCH(QString, locale);
+
+    QMimeDatabase db;
+    // A new QMimeType each time, since the type caches what it loaded
+    QBENCHMARK {
+        db.mimeTypeForName(QString::fromLatin1("application/pdf")).comment(locale);
+    }
+}
+
+void tst_bench_qmimedatabase::icons()
+{
+    QMimeDatabase db;
+    QBENCHMARK {
+        const QMimeType mime = db.mimeTypeForName(QString::fromLatin1("application/pdf"));
+        mime.iconName();
+        mime.genericIconName();
+    }
+}
+
+void tst_bench_qmimedatabase::coldStart()
+{
+    // A private database of its own, so that nothing is shared with the other benchmarks
+    QBENCHMARK {
+        QMimeDatabasePrivate d;
+        QMutexLocker locker(&d.mutex);
+        d.mimeTypeForName(QString::fromLatin1("text/plain"));
+        int accuracy = 0;
+        d.findByData(QByteArray("%PDF-"), &accuracy);
+    }
+}
+
+// The instruction counts of these are compared to callgrind-baseline-*.txt by
+// callgrind.sh, so don't change what they do without updating the baselines.
+void tst_bench_qmimedatabase::globWorkload()
+{
+    QStringList fileNames;
+    foreach (const QString &filePath, m_corpusFiles)
+        fileNames.append(QFileInfo(filePath).fileName());
+
+    QMimeDatabase db;
+    QBENCHMARK {
+        foreach (const QString &fileName, fileNames)
+            db.findByName(fileName);
+    }
+}
+
+void tst_bench_qmimedatabase::magicWorkload()
+{
+    QMimeDatabase db;
+    QBENCHMARK {
+        foreach (const QByteArray &data, m_corpusData)
+            db.findByData(data);
+    }
+}
+
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 0, 0))
+QTEST_GUILESS_MAIN(tst_bench_qmimedatabase)
+#else
+QTEST_MAIN(tst_bench_qmimedatabase)
+#endif
@@ -0,0 +1,51 @@
+/****************************************************************************
+**
+** TODO Provide Licensing information
+**
+****************************************************************************/
+
+#ifndef TST_BENCH_QMIMEDATABASE_H_INCLUDED
+#define TST_BENCH_QMIMEDATABASE_H_INCLUDED
+
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QObject>
+#include <QtCore/QStringList>
+
+class tst_bench_qmimedatabase : public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_bench_qmimedatabase();
+
+private slots:
+    void initTestCase();
+
+    void mimeTypeForName_data();
+    void mimeTypeForName();
+    void findByName_data();
+    void findByName();
+    void findByData_data();
+    void findByData();
+    void findByDataCorpus();
+    void findByFileCorpus();
+    void inherits_data();
+    void inherits();
+    void allParentMimeTypes();
+    void comment_data();
+    void comment();
+    void icons();
+    void coldStart();
+
+    // Fixed workloads for callgrind.sh, run with -callgrind
+    void globWorkload();
+    void magicWorkload();
+
+private:
+    const QString m_expectedProvider;
+    QStringList m_corpusFiles;
+    QList<QByteArray> m_corpusData;
+};
+
+#endif   // TST_BENCH_QMIMEDATABASE_H_INCLUDED
@@ -0,0 +1,274 @@
+/****************************************************************************
+**
+** TODO Provide Licensing information
+**
+****************************************************************************/
+
+// Runs the XML and the mime.cache providers over the same inputs, built from the
+// same freedesktop.org.xml, prints the inputs on which they disagree and the
+// throughput of each provider per operation.
+//
+// The inputs are the shared-mime-info test files (names, data, and both), plus
+// file names generated from every glob pattern and data generated from every
+// plain string magic rule. The exit code is 1 if the providers disagree.
+//
+// Usage: qmimeproviders [-quiet]    (-quiet only prints the number of mismatches)
+
+#include "qmimedatabase.h"
+#include "qmimedatabase_p.h"
+#include "qmimeprovider_p.h"
+#include "mimetypeparser_p.h"
+#include "qmimemagicrulematcher_p.h"
+
+#include <QtCore/QBuffer>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QProcess>
+#include <QtCore/QStringList>
+#include <qstandardpaths.h>
+
+#include <stdio.h>
+
+static const char freedesktopXml[] = SRCDIR "../../../src/mimetypes/mime/packages/freedesktop.org.xml";
+static const char testFilesDir[] = SRCDIR "../../auto/qmimedatabase/testfiles/";
+
+// Collects the glob patterns and the plain string magic values of a package file
+class InputsParser : public BaseMimeTypeParser
+{
+public:
+    QStringList patterns;
+    QList<QByteArray> magicData;
+
+protected:
+    bool process(const QMimeType &, QString *) { return true; }
+    bool process(const QMimeGlobPattern &glob, QString *) { patterns.append(glob.pattern()); return true; }
+    void processParent(const QString &, const QString &) {}
+    void processAlias(const QString &, const QString &) {}
+
+    void processMagicMatcher(const QMimeMagicRuleMatcher &matcher)
+    {
+        foreach (const QMimeMagicRule &rule, matcher.magicRules()) {
+            const QByteArray value = rule.value();
+            if (rule.type() != QMimeMagicRule::String || !rule.mask().isEmpty() || value.contains('\\'))
+                continue;
+            QByteArray data(rule.startPos(), '\0');
+            data += value;
+            magicData.append(data);
+        }
+    }
+};
+
+// A file name matching \a pattern: '*' becomes "file", '?' becomes 'x' and a
+// character class becomes its first character
+static QString fileNameForPattern(const QString &pattern)
+{
+    QString fileName;
+    for (int i = 0; i < pattern.length(); ++i) {
+        const QChar c = pattern.at(i);
+        if (c == QLatin1Char('*')) {
+            fileName += QLatin1String("file");
+        } else if (c == QLatin1Char('?')) {
+            fileName += QLatin1Char('x');
+        } else if (c == QLatin1Char('[') && i + 1 < pattern.length()) {
+            fileName += pattern.at(i + 1);
+            const int end = pattern.indexOf(QLatin1Char(']'), i);
+            if (end == -1)
+                break;
+            i = end;
+        } else {
+            fileName += c;
+        }
+    }
+    return fileName;
+}
+
+struct Inputs
+{
+    QStringList names;
+    QList<QByteArray> data;
+    QStringList filePaths; // for findByNameAndData
+    QList<QByteArray> fileData;
+};
+
+static bool buildInputs(Inputs &inputs)
+{
+    InputsParser parser;
+    QFile xml(QFile::decodeName(freedesktopXml));
+    QString errorMessage;
+    if (!xml.open(QIODevice::ReadOnly) || !parser.parse(&xml, xml.fileName(), &errorMessage)) {
+        fprintf(stderr, "Cannot parse %s %s\n", freedesktopXml, qPrintable(errorMessage));
+        return false;
+    }
+
+    foreach (const QString &pattern, parser.patterns) {
+        const QString fileName = fileNameForPattern(pattern);
+        inputs.names << fileName << fileName.toUpper() << (QLatin1String("dir/my.") + fileName);
+    }
+    inputs.names << QString::fromLatin1("file") << QString::fromLatin1("file.doesnotexist")
+                 << QString::fromLatin1("dir/") << QString::fromLatin1(".hidden");
+    inputs.data = parser.magicData;
+
+    QFile list(QFile::decodeName(testFilesDir) + QLatin1String("list"));
+    if (!list.open(QIODevice::ReadOnly)) {
+        fprintf(stderr, "Cannot open %s\n", qPrintable(list.fileName()));
+        return false;
+    }
+    while (!list.atEnd()) {
+        const QString line = QString::fromLatin1(list.readLine().constData()).trimmed();
+        if (line.isEmpty() || line.startsWith(QLatin1Char('#')))
+            continue;
+        const QString filePath = QFile::decodeName(testFilesDir) + line.section(QLatin1Char(' '), 0, 0);
+        if (inputs.filePaths.contains(filePath))
+            continue;
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly))
+            continue;
+        const QByteArray data = file.read(16384);
+        inputs.names.append(QFileInfo(filePath).fileName());
+        inputs.data << data << data.left(4) << data.left(64);
+        inputs.filePaths.append(filePath);
+        inputs.fileData.append(data);
+    }
+    return true;
+}
+
+// Makes a directory with freedesktop.org.xml and its mime.cache, and uses it
+static bool setUpMimeDirectory()
+{
+    QDir here = QDir::currentPath();
+    here.mkpath(QString::fromLatin1("mime/packages"));
+    const QString tempMime = here.absolutePath() + QString::fromLatin1("/mime");
+    const QString packageFile = tempMime + QString::fromLatin1("/packages/freedesktop.org.xml");
+    QFile::remove(packageFile);
+    QFile::copy(QFile::decodeName(freedesktopXml), packageFile);
+
+    const QString umd = QStandardPaths::findExecutable(QString::fromLatin1("update-mime-database"));
+    if (umd.isEmpty()) {
+        fprintf(stderr, "update-mime-database not found, install shared-mime-info\n");
+        return false;
+    }
+    QProcess proc;
+    proc.setProcessChannelMode(QProcess::MergedChannels); // silence output
+    proc.start(umd, QStringList() << tempMime);
+    proc.waitForFinished();
+    if (!QFile::exists(tempMime + QString::fromLatin1("/mime.cache"))) {
+        fprintf(stderr, "update-mime-database didn't create %s/mime.cache\n", qPrintable(tempMime));
+        return false;
+    }
+
+    qputenv("XDG_DATA_HOME", QByteArray("doesnotexist"));
+    qputenv("XDG_DATA_DIRS", QFile::encodeName(here.absolutePath()));
+    return true;
+}
+
+enum Operation {
+    FindByName,
+    FindByData,
+    FindByNameAndData,
+    OperationCount
+};
+
+static const char *const operationNames[OperationCount] = {
+    "findByName", "findByData", "findByNameAndData"
+};
+
+// Runs \a operation over all its inputs and returns the resulting type names
+static QStringList run(QMimeDatabasePrivate &d, Operation operation, const Inputs &inputs)
+{
+    QStringList results;
+    int accuracy = 0;
+    switch (operation) {
+    case FindByName:
+        foreach (const QString &name, inputs.names)
+            results.append(d.mimeTypeForFileName(name, &accuracy).name());
+        break;
+    case FindByData:
+        foreach (const QByteArray &data, inputs.data)
+            results.append(d.findByData(data, &accuracy).name());
+        break;
+    case FindByNameAndData:
+        for (int i = 0; i < inputs.filePaths.count(); ++i) {
+            QBuffer buffer(const_cast<QByteArray *>(&inputs.fileData.at(i)));
+            results.append(d.findByNameAndData(inputs.filePaths.at(i), &buffer, &accuracy).name());
+        }
+        break;
+    case OperationCount:
+        break;
+    }
+    return results;
+}
+
+static QString describeInput(Operation operation, const Inputs &inputs, int index)
+{
+    switch (operation) {
+    case FindByName:
+        return inputs.names.at(index);
+    case FindByData:
+        return QString::fromLatin1(inputs.data.at(index).left(32).toHex().constData());
+    default:
+        return inputs.filePaths.at(index);
+    }
+}
+
+// Returns the number of lookups per second, running for at least 200 ms
+static double throughput(QMimeDatabasePrivate &d, Operation operation, const Inputs &inputs, int lookups)
+{
+    QElapsedTimer timer;
+    timer.start();
+    int rounds = 0;
+    do {
+        run(d, operation, inputs);
+        ++rounds;
+    } while (timer.elapsed() < 200);
+    return double(lookups) * rounds * 1e9 / timer.nsecsElapsed();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const bool quiet = app.arguments().contains(QLatin1String("-quiet"));
+
+    if (!setUpMimeDirectory())
+        return 2;
+    Inputs inputs;
+    if (!buildInputs(inputs))
+        return 2;
+
+    QMimeDatabasePrivate xmlDatabase;
+    xmlDatabase.setProvider(new QMimeXMLProvider(&xmlDatabase));
+    QMimeDatabasePrivate cacheDatabase;
+    cacheDatabase.setProvider(new QMimeBinaryProvider(&cacheDatabase));
+    if (!cacheDatabase.provider()->isValid()) {
+        fprintf(stderr, "Cannot use the mime.cache file\n");
+        return 2;
+    }
+
+    int mismatches = 0;
+    printf("%-18s %8s %14s %14s\n", "", "lookups", "xml/s", "mime.cache/s");
+    for (int op = 0; op < OperationCount; ++op) {
+        const Operation operation = Operation(op);
+        const QStringList xmlResults = run(xmlDatabase, operation, inputs);
+        const QStringList cacheResults = run(cacheDatabase, operation, inputs);
+        for (int i = 0; i < xmlResults.count(); ++i) {
+            if (xmlResults.at(i) == cacheResults.at(i))
+                continue;
+            ++mismatches;
+            if (!quiet) {
+                fprintf(stderr, "%s(%s): xml %s, mime.cache %s\n", operationNames[operation],
+                        qPrintable(describeInput(operation, inputs, i)),
+                        qPrintable(xmlResults.at(i)), qPrintable(cacheResults.at(i)));
+            }
+        }
+
+        const int lookups = xmlResults.count();
+        printf("%-18s %8d %14.0f %14.0f\n", operationNames[operation], lookups,
+               throughput(xmlDatabase, operation, inputs, lookups),
+               throughput(cacheDatabase, operation, inputs, lookups));
+    }
+
+    printf("%d mismatches\n", mismatches);
+    return mismatches ? 1 : 0;
+}
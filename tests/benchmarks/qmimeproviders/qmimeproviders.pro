@@ -0,0 +1,18 @@
+include(../../../mimetypes.pri)
+
+TEMPLATE = app
+
+TARGET = qmimeproviders
+
+QT       -= widgets gui
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+CONFIG += depend_includepath
+
+SOURCES += main.cpp
+
+DEFINES += SRCDIR='"\\"$$PWD/\\""'
+
+QMAKE_CXXFLAGS += -W -Wall -Wextra -Werror -Wshadow -Wno-long-long -Wnon-virtual-dtor
@@ -0,0 +1,20 @@
+include(../../../mimetypes.pri)
+
+TEMPLATE = app
+
+TARGET = tst_bench_qmimexmlparser
+
+QT       += testlib
+
+QT       -= widgets gui
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+CONFIG += depend_includepath
+
+SOURCES += tst_bench_qmimexmlparser.cpp
+
+DEFINES += SRCDIR='"\\"$$PWD/\\""'
+
+QMAKE_CXXFLAGS += -W -Wall -Wextra -Werror -Wshadow -Wno-long-long -Wnon-virtual-dtor
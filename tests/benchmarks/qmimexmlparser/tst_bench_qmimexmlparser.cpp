@@ -0,0 +1,434 @@
+/****************************************************************************
+**
+** TODO Provide Licensing information
+**
+****************************************************************************/
+
+#include "mimetypeparser_p.h"
+#include "qmimeprovider_p.h"
+#include "qmimemagicrulematcher_p.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+
+#include <QtTest/QtTest>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+static const char freedesktopXml[] = SRCDIR "../../../src/mimetypes/mime/packages/freedesktop.org.xml";
+
+// Writes down everything the parser reports, to compare both parsers
+class RecordingParser : public BaseMimeTypeParser
+{
+public:
+    QStringList records;
+
+protected:
+    bool process(const QMimeType &t, QString *)
+    {
+        const QMimeTypePrivate d(t);
+        QStringList locales = d.localeComments.keys();
+        locales.sort();
+        QString record = QLatin1String("type ") + d.name + QLatin1Char(' ') + d.genericIconName + QLatin1Char(' ')
+                + d.iconName + QLatin1Char(' ') + d.globPatterns.join(QLatin1String(","));
+        foreach (const QString &locale, locales)
+            record += QLatin1Char(' ') + locale + QLatin1Char('=') + d.localeComments.value(locale);
+        records.append(record);
+        return true;
+    }
+
+    bool process(const QMimeGlobPattern &glob, QString *)
+    {
+        records.append(QString::fromLatin1("glob %1 %2 %3 %4").arg(glob.mimeType(), glob.pattern())
+                       .arg(glob.weight()).arg(glob.isCaseSensitive()));
+        return true;
+    }
+
+    void processParent(const QString &child, const QString &parent)
+    { records.append(QLatin1String("parent ") + child + QLatin1Char(' ') + parent); }
+
+    void processAlias(const QString &alias, const QString &name)
+    { records.append(QLatin1String("alias ") + alias + QLatin1Char(' ') + name); }
+
+    void processMagicMatcher(const QMimeMagicRuleMatcher &matcher)
+    {
+        records.append(QString::fromLatin1("magic %1 %2").arg(matcher.mimetype()).arg(matcher.priority()));
+        recordRules(matcher.magicRules(), 1);
+    }
+
+    void processComments(const QString &name, const QHash<QString, QString> &localeComments)
+    {
+        QStringList locales = localeComments.keys();
+        locales.sort();
+        QString record = QLatin1String("comments ") + name;
+        foreach (const QString &locale, locales)
+            record += QLatin1Char(' ') + locale + QLatin1Char('=') + localeComments.value(locale);
+        records.append(record);
+    }
+
+private:
+    void recordRules(const QList<QMimeMagicRule> &rules, int depth)
+    {
+        foreach (const QMimeMagicRule &rule, rules) {
+            records.append(QString::fromLatin1("%1match %2 %3 %4:%5 %6")
+                           .arg(QString(depth, QLatin1Char(' ')))
+                           .arg(QString::fromLatin1(QMimeMagicRule::typeName(rule.type()).constData()))
+                           .arg(QString::fromLatin1(rule.value().toHex().constData()))
+                           .arg(rule.startPos()).arg(rule.endPos())
+                           .arg(QString::fromLatin1(rule.mask().toHex().constData())));
+            recordRules(rule.m_subMatches, depth + 1);
+        }
+    }
+};
+
+// Adds up what the comments would take in memory
+class CommentSizeParser : public BaseMimeTypeParser
+{
+public:
+    CommentSizeParser() : commentCount(0), textBytes(0) { setContents(CommentContent); }
+
+    int commentCount;
+    int textBytes;
+
+protected:
+    bool process(const QMimeType &, QString *) { return true; }
+    bool process(const QMimeGlobPattern &, QString *) { return true; }
+    void processParent(const QString &, const QString &) {}
+    void processAlias(const QString &, const QString &) {}
+    void processMagicMatcher(const QMimeMagicRuleMatcher &) {}
+
+    void processComments(const QString &, const QHash<QString, QString> &localeComments)
+    {
+        QHash<QString, QString>::const_iterator it = localeComments.constBegin();
+        for ( ; it != localeComments.constEnd(); ++it) {
+            ++commentCount;
+            textBytes += (it.key().size() + it.value().size()) * int(sizeof(QChar));
+        }
+    }
+};
+
+// Holds what QMimeXMLProvider holds, in the same containers, but keeps the strings
+// as the parser made them: what the provider would take without its string pool
+class PlainCopyParser : public BaseMimeTypeParser
+{
+protected:
+    bool process(const QMimeType &t, QString *)
+    {
+        m_nameMimeTypeMap.insert(QMimeTypePrivate(t).name, t);
+        return true;
+    }
+
+    bool process(const QMimeGlobPattern &glob, QString *)
+    {
+        m_mimeTypeGlobs.addGlob(glob);
+        return true;
+    }
+
+    void processParent(const QString &child, const QString &parent)
+    { m_parents[child].append(parent); }
+
+    void processAlias(const QString &alias, const QString &name)
+    { m_aliases.insert(alias, name); }
+
+    void processMagicMatcher(const QMimeMagicRuleMatcher &matcher)
+    {
+        m_magicMatcherIndexes[matcher.mimetype()].append(m_magicMatchers.count());
+        m_magicMatchers.append(matcher);
+    }
+
+    void processComments(const QString &name, const QHash<QString, QString> &localeComments)
+    { m_comments.insert(name, localeComments); }
+
+private:
+    QHash<QString, QMimeType> m_nameMimeTypeMap;
+    QHash<QString, QString> m_aliases;
+    QHash<QString, QStringList> m_parents;
+    QMimeAllGlobPatterns m_mimeTypeGlobs;
+    QList<QMimeMagicRuleMatcher> m_magicMatchers;
+    QHash<QString, QList<int> > m_magicMatcherIndexes;
+    QHash<QString, QHash<QString, QString> > m_comments;
+};
+
+class tst_bench_qmimexmlparser : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void sameResults_data();
+    void sameResults();
+    void invalidDocuments_data();
+    void invalidDocuments();
+
+    void load_data();
+    void load();
+
+    void retainedLocales_data();
+    void retainedLocales();
+    void stringInterning();
+
+    void loadFilesOrder();
+    void loadFiles_data();
+    void loadFiles();
+
+private:
+    QFile m_file;
+    const char *m_data;
+    int m_size;
+};
+
+void tst_bench_qmimexmlparser::initTestCase()
+{
+    m_file.setFileName(QFile::decodeName(freedesktopXml));
+    QVERIFY2(m_file.open(QIODevice::ReadOnly), freedesktopXml);
+    m_data = reinterpret_cast<const char *>(m_file.map(0, m_file.size()));
+    QVERIFY(m_data);
+    m_size = int(m_file.size());
+}
+
+void tst_bench_qmimexmlparser::sameResults_data()
+{
+    QTest::addColumn<int>("contents");
+
+    QTest::newRow("all") << int(BaseMimeTypeParser::AllContent);
+    QTest::newRow("types") << int(BaseMimeTypeParser::MimeTypeContent);
+    QTest::newRow("comments") << int(BaseMimeTypeParser::CommentContent);
+    QTest::newRow("magic") << int(BaseMimeTypeParser::MagicContent);
+}
+
+void tst_bench_qmimexmlparser::sameResults()
+{
+    QFETCH(int, contents);
+    QString errorMessage;
+
+    RecordingParser streamParser;
+    streamParser.setContents(contents);
+    m_file.seek(0);
+    QVERIFY2(streamParser.parse(&m_file, m_file.fileName(), &errorMessage), qPrintable(errorMessage));
+
+    RecordingParser fastParser;
+    fastParser.setContents(contents);
+    QCOMPARE(fastParser.parseFast(m_data, m_size, m_file.fileName(), &errorMessage), BaseMimeTypeParser::FastParseSucceeded);
+
+    QCOMPARE(fastParser.records.count(), streamParser.records.count());
+    for (int i = 0; i < fastParser.records.count(); ++i)
+        QCOMPARE(fastParser.records.at(i), streamParser.records.at(i));
+}
+
+void tst_bench_qmimexmlparser::invalidDocuments_data()
+{
+    QTest::addColumn<QByteArray>("document");
+    QTest::addColumn<int>("expectedResult");
+
+    QTest::newRow("empty") << QByteArray() << int(BaseMimeTypeParser::FastParseFailed);
+    QTest::newRow("unclosed") << QByteArray("<mime-info><mime-type type=\"a/b\">") << int(BaseMimeTypeParser::FastParseFailed);
+    QTest::newRow("mismatch") << QByteArray("<mime-info><mime-type type=\"a/b\"></mime-info>") << int(BaseMimeTypeParser::FastParseFailed);
+    QTest::newRow("unexpected element") << QByteArray("<mime-info><glob pattern=\"*.b\"/></mime-info>") << int(BaseMimeTypeParser::FastParseFailed);
+    QTest::newRow("missing type") << QByteArray("<mime-info><mime-type/></mime-info>") << int(BaseMimeTypeParser::FastParseFailed);
+    QTest::newRow("unknown entity") << QByteArray("<mime-info><mime-type type=\"a/b\"><comment>&foo;</comment></mime-type></mime-info>") << int(BaseMimeTypeParser::FastParseFailed);
+    QTest::newRow("latin1") << QByteArray("<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?><mime-info/>") << int(BaseMimeTypeParser::FastParseUnsupported);
+    QTest::newRow("entity declaration") << QByteArray("<!DOCTYPE mime-info [<!ENTITY foo \"bar\">]><mime-info/>") << int(BaseMimeTypeParser::FastParseUnsupported);
+    QTest::newRow("valid") << QByteArray("<?xml version=\"1.0\"?>\n<!-- x -->\n<mime-info><mime-type type=\"a/b\"><comment>A &amp; B</comment></mime-type></mime-info>\n") << int(BaseMimeTypeParser::FastParseSucceeded);
+}
+
+void tst_bench_qmimexmlparser::invalidDocuments()
+{
+    QFETCH(QByteArray, document);
+    QFETCH(int, expectedResult);
+
+    RecordingParser parser;
+    QString errorMessage;
+    QCOMPARE(int(parser.parseFast(document.constData(), document.size(), QLatin1String("test"), &errorMessage)), expectedResult);
+    if (expectedResult == BaseMimeTypeParser::FastParseFailed)
+        QVERIFY(!errorMessage.isEmpty());
+}
+
+void tst_bench_qmimexmlparser::load_data()
+{
+    QTest::addColumn<bool>("fast");
+    QTest::addColumn<int>("contents");
+
+    QTest::newRow("QXmlStreamReader") << false << int(BaseMimeTypeParser::AllContent);
+    QTest::newRow("fast parser") << true << int(BaseMimeTypeParser::AllContent);
+    QTest::newRow("QXmlStreamReader, types only") << false << int(BaseMimeTypeParser::MimeTypeContent);
+    QTest::newRow("fast parser, types only") << true << int(BaseMimeTypeParser::MimeTypeContent);
+}
+
+// Time needed to turn freedesktop.org.xml into the XML provider's data structures
+void tst_bench_qmimexmlparser::load()
+{
+    QFETCH(bool, fast);
+    QFETCH(int, contents);
+
+    QBENCHMARK {
+        QMimeXMLProvider provider(QMimeDatabasePrivate::instance());
+        MimeTypeParser parser(provider);
+        parser.setContents(contents);
+        QString errorMessage;
+        if (fast) {
+            QCOMPARE(parser.parseFast(m_data, m_size, m_file.fileName(), &errorMessage), BaseMimeTypeParser::FastParseSucceeded);
+        } else {
+            m_file.seek(0);
+            QVERIFY2(parser.parse(&m_file, m_file.fileName(), &errorMessage), qPrintable(errorMessage));
+        }
+    }
+}
+
+void tst_bench_qmimexmlparser::retainedLocales_data()
+{
+    QTest::addColumn<QStringList>("locales");
+
+    QTest::newRow("all languages") << QStringList();
+    QTest::newRow("default") << QMimeDatabasePrivate::instance()->retainedLocales();
+}
+
+// The comments kept in memory, with all languages or only the retained ones
+void tst_bench_qmimexmlparser::retainedLocales()
+{
+    QFETCH(QStringList, locales);
+
+    CommentSizeParser sizes;
+    sizes.setCommentLocales(locales.toSet());
+    QString errorMessage;
+    QCOMPARE(sizes.parseFast(m_data, m_size, m_file.fileName(), &errorMessage), BaseMimeTypeParser::FastParseSucceeded);
+    QVERIFY(sizes.commentCount > 0);
+    qDebug("%d comments, %d bytes of text (locales: %s)", sizes.commentCount, sizes.textBytes,
+           locales.isEmpty() ? "all" : qPrintable(locales.join(QLatin1String(" "))));
+
+    QBENCHMARK {
+        QMimeXMLProvider provider(QMimeDatabasePrivate::instance());
+        MimeTypeParser parser(provider);
+        parser.setContents(BaseMimeTypeParser::CommentContent);
+        parser.setCommentLocales(locales.toSet());
+        QCOMPARE(parser.parseFast(m_data, m_size, m_file.fileName(), &errorMessage), BaseMimeTypeParser::FastParseSucceeded);
+    }
+}
+
+// The bytes the process has allocated and not freed yet, or -1 if that isn't known
+static qint64 heapInUse()
+{
+#ifdef __GLIBC__
+#if __GLIBC_PREREQ(2, 33)
+    return qint64(mallinfo2().uordblks);
+#else
+    return qint64(mallinfo().uordblks);
+#endif
+#else
+    return -1;
+#endif
+}
+
+// The heap taken by a provider holding all of freedesktop.org.xml
+static qint64 providerHeapSize(const QString &fileName)
+{
+    const qint64 before = heapInUse();
+    QMimeXMLProvider provider(QMimeDatabasePrivate::instance());
+    QString errorMessage;
+    if (!provider.load(fileName, &errorMessage))
+        return -1;
+    return heapInUse() - before;
+}
+
+// The heap taken by the same data without the string pool
+static qint64 plainCopyHeapSize(const char *data, int size, const QString &fileName)
+{
+    const qint64 before = heapInUse();
+    PlainCopyParser parser;
+    parser.setCommentLocales(QMimeDatabasePrivate::instance()->retainedLocaleSet());
+    QString errorMessage;
+    if (parser.parseFast(data, size, fileName, &errorMessage) != BaseMimeTypeParser::FastParseSucceeded)
+        return -1;
+    return heapInUse() - before;
+}
+
+// What sharing the equal strings saves, measured on the heap
+void tst_bench_qmimexmlparser::stringInterning()
+{
+    if (heapInUse() < 0)
+        QSKIP("Measuring the heap needs glibc", SkipAll);
+
+    const qint64 plainBytes = plainCopyHeapSize(m_data, m_size, m_file.fileName());
+    const qint64 internedBytes = providerHeapSize(m_file.fileName());
+    QVERIFY(plainBytes > 0 && internedBytes > 0);
+    qDebug("%lld heap bytes without interning, %lld with interning (%lld%%)", plainBytes, internedBytes,
+           internedBytes * 100 / plainBytes);
+    QVERIFY(internedBytes < plainBytes);
+}
+
+static QString writePackage(const QString &name, const QByteArray &contents)
+{
+    const QString fileName = QDir::tempPath() + QLatin1String("/tst_bench_qmimexmlparser_") + name + QLatin1String(".xml");
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(contents) != contents.size())
+        return QString();
+    return fileName;
+}
+
+// The packages are parsed in parallel, but must be applied in the given order
+void tst_bench_qmimexmlparser::loadFilesOrder()
+{
+    QStringList fileNames;
+    for (int i = 0; i < 8; ++i) {
+        const QByteArray number = QByteArray::number(i);
+        const QString fileName = writePackage(QString::number(i),
+            "<mime-info><mime-type type=\"application/x-test\"><sub-class-of type=\"application/x-parent" + number + "\"/>"
+            "<alias type=\"application/x-alias\"/><glob pattern=\"*.test" + number + "\"/></mime-type>"
+            "<mime-type type=\"application/x-test" + number + "\"><alias type=\"application/x-alias\"/></mime-type></mime-info>");
+        QVERIFY(!fileName.isEmpty());
+        fileNames.append(fileName);
+    }
+
+    QMimeXMLProvider provider(QMimeDatabasePrivate::instance());
+    provider.loadFiles(fileNames);
+
+    QStringList expectedParents;
+    for (int i = 0; i < 8; ++i)
+        expectedParents.append(QString::fromLatin1("application/x-parent%1").arg(i));
+    QCOMPARE(provider.parents(QString::fromLatin1("application/x-test")), expectedParents);
+    QCOMPARE(provider.resolveAlias(QString::fromLatin1("application/x-alias")), QString::fromLatin1("application/x-test7"));
+    QCOMPARE(provider.allMimeTypeNames().count(), 9);
+
+    foreach (const QString &fileName, fileNames)
+        QFile::remove(fileName);
+}
+
+void tst_bench_qmimexmlparser::loadFiles_data()
+{
+    QTest::addColumn<bool>("parallel");
+
+    QTest::newRow("one after the other") << false;
+    QTest::newRow("parallel") << true;
+}
+
+// Several large packages, as on a system with many applications installed
+void tst_bench_qmimexmlparser::loadFiles()
+{
+    QFETCH(bool, parallel);
+
+    QStringList fileNames;
+    for (int i = 0; i < 8; ++i)
+        fileNames.append(m_file.fileName());
+
+    QBENCHMARK {
+        QMimeXMLProvider provider(QMimeDatabasePrivate::instance());
+        if (parallel) {
+            provider.loadFiles(fileNames);
+        } else {
+            foreach (const QString &fileName, fileNames) {
+                QString errorMessage;
+                QVERIFY2(provider.load(fileName, &errorMessage), qPrintable(errorMessage));
+            }
+        }
+    }
+}
+
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 0, 0))
+QTEST_GUILESS_MAIN(tst_bench_qmimexmlparser)
+#else
+QTEST_MAIN(tst_bench_qmimexmlparser)
+#endif
+
+#include "tst_bench_qmimexmlparser.moc"